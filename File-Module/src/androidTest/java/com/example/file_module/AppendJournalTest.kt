@@ -0,0 +1,95 @@
+package com.example.file_module
+
+import android.system.Os
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.After
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * 追加意图日志: 追加中途崩溃留下的日志只能回滚它记录的那个文件, 目标被替换后不能截断新内容
+ */
+@RunWith(AndroidJUnit4::class)
+class AppendJournalTest {
+
+    private val fileSystem = FileSystem()
+    private lateinit var baseDir: File
+    private lateinit var businessDir: File
+
+    @Before
+    fun setUp() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        baseDir = File(context.cacheDir, "append_journal_test")
+        baseDir.deleteRecursively()
+        businessDir = File(baseDir, BUSINESS_ID)
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 100, false))
+    }
+
+    @After
+    fun tearDown() {
+        baseDir.deleteRecursively()
+    }
+
+    @Test
+    fun updateDiscardsStaleJournal() {
+        assertTrue(fileSystem.createFile(BUSINESS_ID, FILENAME, "old content"))
+        // 模拟追加 "content" 途中崩溃: 日志记录追加前的长度 4
+        writeJournal(File(businessDir, FILENAME), 4)
+
+        assertTrue(fileSystem.updateFile(BUSINESS_ID, FILENAME, "new content"))
+        assertFalse(journalFile().exists())
+        assertTrue(fileSystem.appendFile(BUSINESS_ID, FILENAME, "!"))
+        assertEquals("new content!", fileSystem.readFile(BUSINESS_ID, FILENAME))
+    }
+
+    @Test
+    fun journalForReplacedFileDoesNotTruncate() {
+        assertTrue(fileSystem.createFile(BUSINESS_ID, FILENAME, "old content"))
+        writeJournal(File(businessDir, FILENAME), 4)
+        // 绕过模块替换目标文件, 日志中的 inode 不再匹配
+        val replacement = File(businessDir, "replacement.txt")
+        replacement.writeText("replaced content")
+        assertTrue(replacement.renameTo(File(businessDir, FILENAME)))
+
+        assertTrue(fileSystem.appendFile(BUSINESS_ID, FILENAME, "!"))
+        assertFalse(journalFile().exists())
+        assertEquals("replaced content!", fileSystem.readFile(BUSINESS_ID, FILENAME))
+    }
+
+    @Test
+    fun journalForSameFileRollsBack() {
+        assertTrue(fileSystem.createFile(BUSINESS_ID, FILENAME, "old content"))
+        writeJournal(File(businessDir, FILENAME), 4)
+
+        assertTrue(fileSystem.appendFile(BUSINESS_ID, FILENAME, "!"))
+        assertEquals("old !", fileSystem.readFile(BUSINESS_ID, FILENAME))
+    }
+
+    private fun journalFile() = File(businessDir, ".fm-$FILENAME.append")
+
+    // 布局同 AtomicFileOperator::AppendIntent
+    private fun writeJournal(target: File, originalSize: Long) {
+        val stat = Os.stat(target.absolutePath)
+        val intent = ByteBuffer.allocate(32).order(ByteOrder.nativeOrder())
+            .putInt(APPEND_JOURNAL_MAGIC)
+            .putInt(0)
+            .putLong(originalSize)
+            .putLong(stat.st_dev)
+            .putLong(stat.st_ino)
+        journalFile().writeBytes(intent.array())
+    }
+
+    companion object {
+        private const val BUSINESS_ID = "journal"
+        private const val FILENAME = "log.txt"
+        private const val APPEND_JOURNAL_MAGIC = 0x41504E44
+    }
+}
@@ -0,0 +1,58 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 追加写基准: 文件从 1KB 增长到 100MB, 在各个大小上测量 4KB 追加的平均耗时
+ * 追加只写入新增字节, 理想情况下单次耗时与文件已有大小无关
+ */
+@RunWith(AndroidJUnit4::class)
+class AppendScalingBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun appendCostByFileSize() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "append_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        val target = File(File(baseDir, BUSINESS_ID), FILENAME)
+        val chunk = ByteArray(CHUNK_SIZE) { 'a'.code.toByte() }
+        val filler = ByteArray(FILLER_SIZE) { 'b'.code.toByte() }
+        assertTrue(fileSystem.createFileBytes(BUSINESS_ID, FILENAME, ByteArray(1024)))
+
+        for (checkpoint in longArrayOf(1024L, 1L shl 20, 10L shl 20, 100L shl 20)) {
+            // 不计时地增长到检查点
+            while (target.length() + FILLER_SIZE <= checkpoint) {
+                assertTrue(fileSystem.appendFileBytes(BUSINESS_ID, FILENAME, filler))
+            }
+
+            val begin = System.nanoTime()
+            repeat(SAMPLES) {
+                assertTrue(fileSystem.appendFileBytes(BUSINESS_ID, FILENAME, chunk))
+            }
+            val elapsedNs = System.nanoTime() - begin
+            Log.i(TAG, "fileSize=${checkpoint / 1024}KB appends=$SAMPLES " +
+                    "elapsed=${elapsedNs / 1_000_000}ms perAppend=${elapsedNs / SAMPLES / 1000}us")
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "AppendScalingBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val FILENAME = "growing.log"
+        private const val CHUNK_SIZE = 4 * 1024
+        private const val FILLER_SIZE = 1024 * 1024
+        private const val SAMPLES = 200
+    }
+}
@@ -0,0 +1,52 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 异步写入吞吐基准: 分别以 1, 2, 4, 8 个写入线程提交相同的写入, 统计提交到全部落地的耗时
+ */
+@RunWith(AndroidJUnit4::class)
+class AsyncWriterBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun writeThroughputByWorkerCount() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val payload = "x".repeat(PAYLOAD_SIZE)
+
+        for (workers in intArrayOf(1, 2, 4, 8)) {
+            val baseDir = File(context.cacheDir, "writer_benchmark_$workers")
+            baseDir.deleteRecursively()
+            assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, true, workers))
+
+            val start = System.nanoTime()
+            for (i in 0 until FILE_COUNT) {
+                fileSystem.updateFile(BUSINESS_ID, "file_$i.dat", payload)
+            }
+            fileSystem.flushWrites()
+            val elapsedMs = (System.nanoTime() - start) / 1_000_000.0
+
+            val written = File(baseDir, BUSINESS_ID).listFiles()?.size ?: 0
+            assertEquals(FILE_COUNT, written)
+            Log.i(TAG, "workers=$workers files=$FILE_COUNT elapsed=${"%.1f".format(elapsedMs)}ms " +
+                    "throughput=${"%.0f".format(FILE_COUNT * 1000 / elapsedMs)} files/s")
+
+            baseDir.deleteRecursively()
+        }
+    }
+
+    companion object {
+        private const val TAG = "AsyncWriterBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val FILE_COUNT = 2000
+        private const val PAYLOAD_SIZE = 4 * 1024
+    }
+}
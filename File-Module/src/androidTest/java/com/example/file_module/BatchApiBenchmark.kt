@@ -0,0 +1,71 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 批量接口基准: 50 到 200 个小文件分别逐个调用与一次批量调用读写
+ * 逐个调用每个文件都要跨越一次 JNI 并转换字符串, 批量接口整批只跨越一次
+ */
+@RunWith(AndroidJUnit4::class)
+class BatchApiBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun loopVersusBatchByFileCount() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "batch_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        for (count in intArrayOf(50, 100, 200)) {
+            val businessIds = Array<String?>(count) { BUSINESS_ID }
+            val filenames = Array<String?>(count) { "item_$it.json" }
+            val payloads = Array<ByteArray?>(count) { "{\"id\":$it}".toByteArray() }
+
+            var start = System.nanoTime()
+            repeat(ROUNDS) {
+                for (i in 0 until count) {
+                    assertTrue(fileSystem.updateFileBytes(BUSINESS_ID, filenames[i], payloads[i]))
+                }
+                for (i in 0 until count) {
+                    assertNotNull(fileSystem.readFileBytes(BUSINESS_ID, filenames[i]))
+                }
+            }
+            val loopMs = (System.nanoTime() - start) / 1_000_000.0 / ROUNDS
+
+            start = System.nanoTime()
+            repeat(ROUNDS) {
+                val written = fileSystem.batchWrite(businessIds, filenames, payloads)
+                assertNotNull(written)
+                assertTrue(written!!.all { it })
+                assertNotNull(fileSystem.batchRead(businessIds, filenames))
+            }
+            val batchMs = (System.nanoTime() - start) / 1_000_000.0 / ROUNDS
+
+            val contents = fileSystem.batchRead(businessIds, filenames)
+            assertNotNull(contents)
+            for (i in 0 until count) {
+                assertArrayEquals(payloads[i], contents!![i])
+            }
+
+            Log.i(TAG, "files=$count loop=${"%.3f".format(loopMs)}ms batch=${"%.3f".format(batchMs)}ms")
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "BatchApiBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val ROUNDS = 20
+    }
+}
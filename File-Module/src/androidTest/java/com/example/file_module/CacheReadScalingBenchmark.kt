@@ -0,0 +1,69 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.util.concurrent.CountDownLatch
+import kotlin.concurrent.thread
+
+/**
+ * 缓存读取扩展性基准: 1 到 16 个线程反复读取同一组热点文件
+ * 每次读取都会命中分片 CLOCK 路径缓存与内容缓存, 命中不取独占锁, 理想情况下总吞吐随线程数近似线性增长
+ */
+@RunWith(AndroidJUnit4::class)
+class CacheReadScalingBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun hotReadsByThreadCount() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "cache_read_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        for (i in 0 until HOT_FILES) {
+            assertTrue(fileSystem.createFile(BUSINESS_ID, "hot_$i.json", "{\"id\":$i}".padEnd(256, ' ')))
+        }
+        // 预热, 之后的读取全部命中缓存
+        for (i in 0 until HOT_FILES) {
+            assertNotNull(fileSystem.readFile(BUSINESS_ID, "hot_$i.json"))
+        }
+
+        for (threads in intArrayOf(1, 2, 4, 8, MAX_THREADS)) {
+            val start = CountDownLatch(1)
+            val workers = (0 until threads).map { index ->
+                thread {
+                    start.await()
+                    for (i in 0 until ITERATIONS) {
+                        val content = fileSystem.readFile(BUSINESS_ID, "hot_${(i + index) % HOT_FILES}.json")
+                        assertNotNull(content)
+                    }
+                }
+            }
+
+            val begin = System.nanoTime()
+            start.countDown()
+            workers.forEach { it.join() }
+            val elapsedNs = System.nanoTime() - begin
+            val ops = threads.toLong() * ITERATIONS
+            Log.i(TAG, "threads=$threads ops=$ops elapsed=${elapsedNs / 1_000_000}ms " +
+                    "throughput=${ops * 1_000_000_000 / elapsedNs}ops/s")
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "CacheReadScalingBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val HOT_FILES = 64
+        private const val MAX_THREADS = 16
+        private const val ITERATIONS = 20_000
+    }
+}
@@ -0,0 +1,62 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 压缩存储基准: 向开启与未开启压缩的业务目录写入相同的 JSON 日志
+ * 统计写入耗时, 读取耗时与磁盘占用
+ */
+@RunWith(AndroidJUnit4::class)
+class CompressionBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun jsonLogsWithAndWithoutCompression() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "compression_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, true))
+        fileSystem.setCompression(COMPRESSED_ID, true)
+
+        val lines = (0 until LINES_PER_FILE).joinToString("\n") {
+            "{\"id\":$it,\"event\":\"page_view\",\"ts\":${1_700_000_000_000L + it},\"user\":\"u${it % 97}\"}"
+        }.toByteArray()
+
+        for (businessId in arrayOf(PLAIN_ID, COMPRESSED_ID)) {
+            var start = System.nanoTime()
+            for (i in 0 until FILE_COUNT) {
+                assertTrue(fileSystem.updateFileBytes(businessId, "log_$i.json", lines))
+            }
+            fileSystem.flushWrites()
+            val writeMs = (System.nanoTime() - start) / 1_000_000.0
+
+            start = System.nanoTime()
+            for (i in 0 until FILE_COUNT) {
+                assertEquals(lines.size, fileSystem.readFileBytes(businessId, "log_$i.json")?.size)
+            }
+            val readMs = (System.nanoTime() - start) / 1_000_000.0
+
+            val stored = File(baseDir, businessId).listFiles()?.sumOf { it.length() } ?: 0L
+            Log.i(TAG, "business=$businessId raw=${lines.size.toLong() * FILE_COUNT / 1024}KB " +
+                    "stored=${stored / 1024}KB write=${"%.1f".format(writeMs)}ms read=${"%.1f".format(readMs)}ms")
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "CompressionBenchmark"
+        private const val PLAIN_ID = "plain"
+        private const val COMPRESSED_ID = "compressed"
+        private const val FILE_COUNT = 50
+        private const val LINES_PER_FILE = 20_000
+    }
+}
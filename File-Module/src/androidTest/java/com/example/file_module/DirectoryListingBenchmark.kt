@@ -0,0 +1,96 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 目录列举基准: 分别在 1 千, 1 万, 10 万个文件的业务目录上执行 prefetchDirectory
+ * 首次调用需要完整扫描目录建立索引, 与扫描方式的耗时相当; 之后的调用只查询内存索引
+ * 分页接口另外统计首次扫描时拿到第一页的延迟
+ */
+@RunWith(AndroidJUnit4::class)
+class DirectoryListingBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun scanVersusIndexByFileCount() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+
+        for (fileCount in intArrayOf(1_000, 10_000, 100_000)) {
+            val baseDir = File(context.cacheDir, "listing_benchmark")
+            baseDir.deleteRecursively()
+            val businessDir = File(baseDir, BUSINESS_ID)
+            assertTrue(businessDir.mkdirs())
+            for (i in 0 until fileCount) {
+                File(businessDir, "log_$i.txt").writeText("x")
+            }
+            assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+            var start = System.nanoTime()
+            val scanned = fileSystem.prefetchDirectory(BUSINESS_ID, SUB_STR, 1, true)
+            val scanMs = (System.nanoTime() - start) / 1_000_000.0
+
+            start = System.nanoTime()
+            repeat(ROUNDS) {
+                val indexed = fileSystem.prefetchDirectory(BUSINESS_ID, SUB_STR, 1, true)
+                assertEquals(scanned?.size, indexed?.size)
+            }
+            val indexMs = (System.nanoTime() - start) / 1_000_000.0 / ROUNDS
+
+            Log.i(TAG, "files=$fileCount matches=${scanned?.size} " +
+                    "scan=${"%.2f".format(scanMs)}ms index=${"%.2f".format(indexMs)}ms")
+
+            baseDir.deleteRecursively()
+        }
+    }
+
+    @Test
+    fun firstPageLatencyByFileCount() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+
+        for (fileCount in intArrayOf(10_000, 100_000)) {
+            val baseDir = File(context.cacheDir, "listing_benchmark")
+            baseDir.deleteRecursively()
+            val businessDir = File(baseDir, BUSINESS_ID)
+            assertTrue(businessDir.mkdirs())
+            for (i in 0 until fileCount) {
+                File(businessDir, "log_$i.txt").writeText("x")
+            }
+            assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+            // 索引尚未建立, 第一页在扫描过程中交付
+            val start = System.nanoTime()
+            var firstPageMs = 0.0
+            var total = 0
+            assertTrue(fileSystem.prefetchDirectoryPaged(BUSINESS_ID, pageSize = PAGE_SIZE) { page ->
+                if (total == 0) {
+                    firstPageMs = (System.nanoTime() - start) / 1_000_000.0
+                }
+                total += page.size
+                true
+            })
+            val fullMs = (System.nanoTime() - start) / 1_000_000.0
+            assertEquals(fileCount, total)
+
+            Log.i(TAG, "files=$fileCount firstPage=${"%.2f".format(firstPageMs)}ms " +
+                    "full=${"%.2f".format(fullMs)}ms")
+
+            baseDir.deleteRecursively()
+        }
+    }
+
+    companion object {
+        private const val TAG = "DirectoryListingBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val SUB_STR = "_7"
+        private const val ROUNDS = 10
+        private const val PAGE_SIZE = 256
+    }
+}
@@ -0,0 +1,107 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 单次操作延迟基准: 同步模式下按文件大小统计 create / read / update 的 p50 与 p99
+ * 每个文件写入后只读一次, 读取不会命中内容缓存
+ * 同一轮中以 java.io 流 (缓冲写入, 整体读取, 临时文件 + rename 更新) 作为基线, 对应此前基于流的实现
+ */
+@RunWith(AndroidJUnit4::class)
+class FileIoLatencyBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun perOperationLatencyBySize() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "file_io_latency_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        for (size in intArrayOf(1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024)) {
+            val payload = ByteArray(size) { it.toByte() }
+            val updated = ByteArray(size) { (it + 1).toByte() }
+            val create = LongArray(ITERATIONS)
+            val read = LongArray(ITERATIONS)
+            val update = LongArray(ITERATIONS)
+
+            for (i in 0 until ITERATIONS) {
+                val filename = "file_${size}_$i.bin"
+
+                var start = System.nanoTime()
+                assertTrue(fileSystem.createFileBytes(BUSINESS_ID, filename, payload))
+                create[i] = System.nanoTime() - start
+
+                start = System.nanoTime()
+                val content = fileSystem.readFileBytes(BUSINESS_ID, filename)
+                read[i] = System.nanoTime() - start
+                assertArrayEquals(payload, content)
+
+                start = System.nanoTime()
+                assertTrue(fileSystem.updateFileBytes(BUSINESS_ID, filename, updated))
+                update[i] = System.nanoTime() - start
+
+                // 4 MB 档位下保留全部文件会占用近 1 GB 空间
+                assertTrue(fileSystem.deleteFile(BUSINESS_ID, filename))
+            }
+
+            Log.i(TAG, "size=${size / 1024}KB create=${summary(create)} " +
+                    "read=${summary(read)} update=${summary(update)}")
+            baseline(File(baseDir, "baseline"), size, payload, updated)
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    private fun baseline(dir: File, size: Int, payload: ByteArray, updated: ByteArray) {
+        dir.mkdirs()
+        val create = LongArray(ITERATIONS)
+        val read = LongArray(ITERATIONS)
+        val update = LongArray(ITERATIONS)
+
+        for (i in 0 until ITERATIONS) {
+            val file = File(dir, "file_${size}_$i.bin")
+            val temp = File(dir, "file_${size}_$i.bin.tmp")
+
+            var start = System.nanoTime()
+            file.outputStream().buffered().use { it.write(payload) }
+            create[i] = System.nanoTime() - start
+
+            start = System.nanoTime()
+            val content = file.readBytes()
+            read[i] = System.nanoTime() - start
+            assertArrayEquals(payload, content)
+
+            start = System.nanoTime()
+            temp.outputStream().buffered().use { it.write(updated) }
+            assertTrue(temp.renameTo(file))
+            update[i] = System.nanoTime() - start
+
+            assertTrue(file.delete())
+        }
+
+        Log.i(TAG, "baseline size=${size / 1024}KB create=${summary(create)} " +
+                "read=${summary(read)} update=${summary(update)}")
+    }
+
+    private fun summary(samples: LongArray): String {
+        samples.sort()
+        val p50 = samples[samples.size / 2] / 1000.0
+        val p99 = samples[samples.size * 99 / 100] / 1000.0
+        return "p50=${"%.1f".format(p50)}us p99=${"%.1f".format(p99)}us"
+    }
+
+    companion object {
+        private const val TAG = "FileIoLatencyBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val ITERATIONS = 200
+    }
+}
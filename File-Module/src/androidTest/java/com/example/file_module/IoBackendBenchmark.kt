@@ -0,0 +1,64 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * I/O 后端基准: 同步实现与 io_uring 实现分别写入同样的批次
+ * 同步实现逐个 open/write/close/rename, io_uring 实现每个批次只需一次提交; 设备不支持 io_uring 时只记录同步结果
+ */
+@RunWith(AndroidJUnit4::class)
+class IoBackendBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun syncVersusIoUringByBatchSize() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "io_backend_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, true))
+
+        for (count in intArrayOf(16, 64, 256)) {
+            val businessIds = Array<String?>(count) { BUSINESS_ID }
+            val filenames = Array<String?>(count) { "item_$it.bin" }
+            val payloads = Array<ByteArray?>(count) { ByteArray(PAYLOAD_SIZE) { b -> (b + it).toByte() } }
+
+            for (backend in intArrayOf(FileSystem.IO_BACKEND_SYNC, FileSystem.IO_BACKEND_IO_URING)) {
+                val actual = fileSystem.setIoBackend(backend)
+                if (actual != backend) {
+                    Log.i(TAG, "backend=$backend unavailable, skipped")
+                    continue
+                }
+
+                val start = System.nanoTime()
+                repeat(ROUNDS) {
+                    val written = fileSystem.batchWrite(businessIds, filenames, payloads)
+                    assertNotNull(written)
+                    assertTrue(written!!.all { it })
+                    fileSystem.flushWrites()
+                }
+                val elapsedMs = (System.nanoTime() - start) / 1_000_000.0 / ROUNDS
+
+                Log.i(TAG, "backend=${if (backend == FileSystem.IO_BACKEND_SYNC) "sync" else "io_uring"} " +
+                        "files=$count batch=${"%.3f".format(elapsedMs)}ms")
+            }
+        }
+
+        fileSystem.setIoBackend(FileSystem.IO_BACKEND_SYNC)
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "IoBackendBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val PAYLOAD_SIZE = 4096
+        private const val ROUNDS = 20
+    }
+}
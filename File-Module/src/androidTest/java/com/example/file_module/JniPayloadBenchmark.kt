@@ -0,0 +1,85 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.nio.ByteBuffer
+
+/**
+ * JNI 传参开销基准: 分别以 String, byte[] 与 direct ByteBuffer 写入并读回 1 KB, 1 MB, 32 MB 的内容
+ * String 接口需要 modified UTF-8 转换, 二进制接口只做一次内存拷贝
+ */
+@RunWith(AndroidJUnit4::class)
+class JniPayloadBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun payloadBySize() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "jni_payload_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        for (size in intArrayOf(1024, 1024 * 1024, 32 * 1024 * 1024)) {
+            val rounds = if (size >= 32 * 1024 * 1024) 3 else ROUNDS
+            val text = "x".repeat(size)
+            val bytes = ByteArray(size) { (it * 31).toByte() }
+            val buffer = ByteBuffer.allocateDirect(size).put(bytes)
+            buffer.flip()
+
+            var start = System.nanoTime()
+            repeat(rounds) {
+                assertTrue(fileSystem.updateFile(BUSINESS_ID, "string.dat", text))
+                assertEquals(size, fileSystem.readFile(BUSINESS_ID, "string.dat")?.length)
+            }
+            val stringMs = (System.nanoTime() - start) / 1_000_000.0 / rounds
+
+            start = System.nanoTime()
+            repeat(rounds) {
+                assertTrue(fileSystem.updateFileBytes(BUSINESS_ID, "bytes.dat", bytes))
+                assertEquals(size, fileSystem.readFileBytes(BUSINESS_ID, "bytes.dat")?.size)
+            }
+            val bytesMs = (System.nanoTime() - start) / 1_000_000.0 / rounds
+
+            val output = ByteBuffer.allocateDirect(size)
+            start = System.nanoTime()
+            repeat(rounds) {
+                assertTrue(fileSystem.updateFileBuffer(BUSINESS_ID, "buffer.dat", buffer))
+                assertEquals(size, fileSystem.readFileBuffer(BUSINESS_ID, "buffer.dat", output))
+            }
+            val bufferMs = (System.nanoTime() - start) / 1_000_000.0 / rounds
+
+            // 二进制内容原样读回
+            assertArrayEquals(bytes, fileSystem.readFileBytes(BUSINESS_ID, "bytes.dat"))
+            val copied = ByteArray(size)
+            output.get(copied)
+            assertArrayEquals(bytes, copied)
+
+            Log.i(TAG, "size=$size string=${"%.3f".format(stringMs)}ms " +
+                    "bytes=${"%.3f".format(bytesMs)}ms buffer=${"%.3f".format(bufferMs)}ms")
+        }
+
+        // 空文件读回空内容而不是 null
+        assertTrue(fileSystem.updateFileBytes(BUSINESS_ID, "empty.dat", ByteArray(0)))
+        assertEquals("", fileSystem.readFile(BUSINESS_ID, "empty.dat"))
+        val empty = fileSystem.readFileBytes(BUSINESS_ID, "empty.dat")
+        assertNotNull(empty)
+        assertEquals(0, empty!!.size)
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "JniPayloadBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val ROUNDS = 20
+    }
+}
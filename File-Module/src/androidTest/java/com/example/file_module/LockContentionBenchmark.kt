@@ -0,0 +1,66 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.util.concurrent.CountDownLatch
+import kotlin.concurrent.thread
+
+/**
+ * 文件锁竞争基准: 1 到 32 个线程各自反复 mapFile/unmapFile 互不相关的文件
+ * 每次映射都要经过路径到锁的查表与文件读锁, 线程间没有共享的文件, 理想情况下单次耗时不随线程数增长
+ */
+@RunWith(AndroidJUnit4::class)
+class LockContentionBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun disjointFilesByThreadCount() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "lock_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        for (i in 0 until MAX_THREADS) {
+            assertTrue(fileSystem.createFile(BUSINESS_ID, "file_$i.dat", "x".repeat(1024)))
+        }
+
+        for (threads in intArrayOf(1, 4, 16, MAX_THREADS)) {
+            val start = CountDownLatch(1)
+            val workers = (0 until threads).map { index ->
+                thread {
+                    val filename = "file_$index.dat"
+                    start.await()
+                    repeat(ITERATIONS) {
+                        val buffer = fileSystem.mapFile(BUSINESS_ID, filename)
+                        assertNotNull(buffer)
+                        fileSystem.unmapFile(buffer)
+                    }
+                }
+            }
+
+            val begin = System.nanoTime()
+            start.countDown()
+            workers.forEach { it.join() }
+            val elapsedNs = System.nanoTime() - begin
+            val perOpNs = elapsedNs / (threads.toLong() * ITERATIONS)
+            Log.i(TAG, "threads=$threads ops=${threads * ITERATIONS} " +
+                    "elapsed=${elapsedNs / 1_000_000}ms perOp=${perOpNs}ns")
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "LockContentionBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val MAX_THREADS = 32
+        private const val ITERATIONS = 20_000
+    }
+}
@@ -0,0 +1,53 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 元数据访问顺序基准: 分别跟踪 1 万和 10 万个路径, 统计每次 fileExists 触达元数据的平均耗时
+ * 元数据上限跟随 cacheSize, 所有路径都保留在 LRU 中, 不发生淘汰
+ */
+@RunWith(AndroidJUnit4::class)
+class MetadataTrackingBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun touchCostByTrackedPaths() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+
+        for (tracked in intArrayOf(10_000, 100_000)) {
+            val baseDir = File(context.cacheDir, "metadata_benchmark")
+            baseDir.deleteRecursively()
+            assertTrue(fileSystem.initManager(baseDir.absolutePath, tracked, false))
+
+            val names = Array(tracked) { "file_$it.dat" }
+            // 首轮插入全部路径, 不存在的文件同样会被跟踪
+            for (name in names) {
+                fileSystem.fileExists(BUSINESS_ID, name)
+            }
+
+            val start = System.nanoTime()
+            repeat(ROUNDS) {
+                for (name in names) {
+                    fileSystem.fileExists(BUSINESS_ID, name)
+                }
+            }
+            val perTouchNs = (System.nanoTime() - start) / (ROUNDS.toLong() * tracked)
+            Log.i(TAG, "tracked=$tracked rounds=$ROUNDS touch=${perTouchNs}ns")
+
+            baseDir.deleteRecursively()
+        }
+    }
+
+    companion object {
+        private const val TAG = "MetadataTrackingBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val ROUNDS = 3
+    }
+}
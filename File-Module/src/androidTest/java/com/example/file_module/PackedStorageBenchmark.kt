@@ -0,0 +1,75 @@
+package com.example.file_module
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * 小文件打包存储基准: 向普通目录与打包目录各写入大量 1KB 以内的小文件
+ * 统计写入, 读取, 列目录与删除耗时, 以及目录下实际占用的文件数
+ */
+@RunWith(AndroidJUnit4::class)
+class PackedStorageBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun smallFilesPackedVsPlain() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "packed_storage_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, true))
+        assertTrue(fileSystem.enablePackedStorage(PACKED_ID))
+
+        val payloads = Array(PAYLOAD_VARIANTS) { i -> ByteArray(64 + i * 96) { (it + i).toByte() } }
+
+        for (businessId in arrayOf(PLAIN_ID, PACKED_ID)) {
+            var start = System.nanoTime()
+            for (i in 0 until FILE_COUNT) {
+                assertTrue(fileSystem.createFileBytes(businessId, "item_$i", payloads[i % PAYLOAD_VARIANTS]))
+            }
+            fileSystem.flushWrites()
+            val writeMs = (System.nanoTime() - start) / 1_000_000.0
+
+            start = System.nanoTime()
+            for (i in 0 until FILE_COUNT) {
+                assertEquals(payloads[i % PAYLOAD_VARIANTS].size,
+                        fileSystem.readFileBytes(businessId, "item_$i")?.size)
+            }
+            val readMs = (System.nanoTime() - start) / 1_000_000.0
+
+            start = System.nanoTime()
+            val listed = fileSystem.prefetchDirectory(businessId, "item_", 0, false)
+            val listMs = (System.nanoTime() - start) / 1_000_000.0
+            assertEquals(FILE_COUNT, listed?.size)
+
+            val inodes = File(baseDir, businessId).walk().count()
+
+            start = System.nanoTime()
+            for (i in 0 until FILE_COUNT step 2) {
+                assertTrue(fileSystem.deleteFile(businessId, "item_$i"))
+            }
+            fileSystem.flushWrites()
+            val deleteMs = (System.nanoTime() - start) / 1_000_000.0
+
+            Log.i(TAG, "business=$businessId files=$FILE_COUNT inodes=$inodes " +
+                    "write=${"%.1f".format(writeMs)}ms read=${"%.1f".format(readMs)}ms " +
+                    "list=${"%.1f".format(listMs)}ms delete=${"%.1f".format(deleteMs)}ms")
+        }
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "PackedStorageBenchmark"
+        private const val PLAIN_ID = "plain"
+        private const val PACKED_ID = "packed"
+        private const val FILE_COUNT = 50_000
+        private const val PAYLOAD_VARIANTS = 10
+    }
+}
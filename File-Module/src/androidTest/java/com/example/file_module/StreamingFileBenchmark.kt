@@ -0,0 +1,86 @@
+package com.example.file_module
+
+import android.os.Debug
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.nio.ByteBuffer
+
+/**
+ * 流式读写基准: 以 1 MB 为一块写入并读回 256 MB 的文件
+ * 统计吞吐量与 native 堆增量, 峰值内存应只与块大小有关
+ */
+@RunWith(AndroidJUnit4::class)
+class StreamingFileBenchmark {
+
+    private val fileSystem = FileSystem()
+
+    @Test
+    fun largeFileInChunks() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val baseDir = File(context.cacheDir, "streaming_benchmark")
+        baseDir.deleteRecursively()
+        assertTrue(fileSystem.initManager(baseDir.absolutePath, 1000, false))
+
+        val chunk = ByteBuffer.allocateDirect(CHUNK_SIZE)
+        val heapBefore = Debug.getNativeHeapAllocatedSize()
+        var heapPeak = heapBefore
+
+        var start = System.nanoTime()
+        val writer = fileSystem.openWriteStream(BUSINESS_ID, FILENAME)
+        assertNotEquals(0L, writer)
+        for (i in 0 until CHUNK_COUNT) {
+            chunk.clear()
+            chunk.put(0, i.toByte())
+            assertTrue(fileSystem.writeStreamBuffer(writer, chunk))
+            heapPeak = maxOf(heapPeak, Debug.getNativeHeapAllocatedSize())
+        }
+        assertTrue(fileSystem.commitWriteStream(writer))
+        val writeMs = (System.nanoTime() - start) / 1_000_000.0
+
+        start = System.nanoTime()
+        val reader = fileSystem.openReadStream(BUSINESS_ID, FILENAME)
+        assertNotEquals(0L, reader)
+        assertEquals(CHUNK_SIZE.toLong() * CHUNK_COUNT, fileSystem.readStreamSize(reader))
+        var total = 0L
+        var index = 0
+        while (true) {
+            chunk.clear()
+            val n = fileSystem.readStreamBuffer(reader, chunk)
+            assertTrue(n >= 0)
+            if (n == 0) {
+                break
+            }
+            // 每块的首字节为块序号
+            if (total % CHUNK_SIZE == 0L) {
+                assertEquals(index.toByte(), chunk.get(0))
+                index++
+            }
+            total += n
+            heapPeak = maxOf(heapPeak, Debug.getNativeHeapAllocatedSize())
+        }
+        fileSystem.closeReadStream(reader)
+        val readMs = (System.nanoTime() - start) / 1_000_000.0
+        assertEquals(CHUNK_SIZE.toLong() * CHUNK_COUNT, total)
+
+        val mb = CHUNK_SIZE.toLong() * CHUNK_COUNT / (1024 * 1024)
+        Log.i(TAG, "size=${mb}MB write=${"%.1f".format(writeMs)}ms read=${"%.1f".format(readMs)}ms " +
+                "nativeHeapGrowth=${(heapPeak - heapBefore) / 1024}KB")
+
+        baseDir.deleteRecursively()
+    }
+
+    companion object {
+        private const val TAG = "StreamingFileBenchmark"
+        private const val BUSINESS_ID = "benchmark"
+        private const val FILENAME = "large.bin"
+        private const val CHUNK_SIZE = 1024 * 1024
+        private const val CHUNK_COUNT = 256
+    }
+}
@@ -5,105 +5,653 @@
 #include "AsyncBatchWriter.h"
 
 
-AsyncBatchWriter::AsyncBatchWriter()
-        : _max_batch_size(50), _min_batch_size(5),
-          _batch_interval(100), _max_wait_time(50),
-          _stop_flag(false), _adaptive_mode(true) {
-    _worker_thread = thread([this] { worker_loop(); });
+AsyncBatchWriter::AsyncBatchWriter(size_t worker_count)
+        : _stop_flag(false),
+          _max_batch_size(50), _min_batch_size(5),
+          _max_wait_time(50), _adaptive_mode(true),
+          _max_pending_per_worker(DEFAULT_MAX_PENDING),
+          _overflow_policy(OverflowPolicy::BLOCK) {
+    worker_count = max<size_t>(1, worker_count);
+    _max_pending_per_worker = (DEFAULT_MAX_PENDING + worker_count - 1) / worker_count;
+
+    _workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        auto worker = make_unique<Worker>();
+        worker->linger = chrono::milliseconds(_max_wait_time.load());
+        worker->sample_start = Clock::now();
+        _workers.push_back(std::move(worker));
+    }
+    // 所有 Worker 构造完成后再启动线程, 避免 _workers 扩容时被并发访问
+    for (auto& worker : _workers) {
+        Worker& w = *worker;
+        w.worker_thread = thread([this, &w] { worker_loop(w); });
+    }
 }
 
 
 AsyncBatchWriter::~AsyncBatchWriter() {
+    _stop_flag = true;
+
+    for (auto& worker : _workers) {
+        {
+            // 持锁通知, 避免工作线程在检查 _stop_flag 与进入等待之间错过唤醒
+            lock_guard lock(worker->queue_mutex);
+        }
+        worker->cv.notify_all();
+        worker->space_cv.notify_all();
+        worker->idle_cv.notify_all();
+    }
+    for (auto& worker : _workers) {
+        if (worker->worker_thread.joinable()) {
+            worker->worker_thread.join();
+        }
+    }
+
+    // 退出前执行剩余请求, 保证每个 future 都能拿到结果
+    for (auto& worker : _workers) {
+        vector<PendingItem> remaining;
+        for (auto& item : worker->queue) {
+            remaining.push_back(std::move(item));
+        }
+        worker->queue.clear();
+        worker->pending_writes.clear();
+        add_depth(0, remaining.size());
+        execute_batch(remaining);
+    }
+}
+
+
+bool AsyncBatchWriter::enqueue(AsyncBatchWriter::Task task) {
+    // 无路径的任务轮流分配给各个工作线程
+    Worker& worker = *_workers[_next_task_worker.fetch_add(1, memory_order_relaxed) % _workers.size()];
+    vector<PendingItem> dropped;
+    bool accepted = false;
     {
-        lock_guard lock(_mutex);
-        _stop_flag = true;
+        unique_lock lock(worker.queue_mutex);
+        _enqueued_count.fetch_add(1, memory_order_relaxed);
+
+        bool waited = false;
+        accepted = acquire_slot_locked(worker, lock, dropped, waited);
+        if (accepted) {
+            PendingItem item;
+            item.task = std::move(task);
+            item.enqueued_at = Clock::now();
+            worker.queue.push_back(std::move(item));
+            worker.enqueued_since_sample++;
+            add_depth(1, 0);
+            //唤醒工作线程
+            notify_worker_locked(worker);
+        }
+    }
+
+    // 回调可能再次入队, 在锁外完成被丢弃的请求
+    for (auto& item : dropped) {
+        complete(item, false);
+    }
+    return accepted;
+}
+
+
+future<bool> AsyncBatchWriter::enqueue_write(WriteType type, const std::string &path,
+                                             std::string payload, Durability durability) {
+    auto waiter = make_shared<promise<bool>>();
+    future<bool> result = waiter->get_future();
+
+    enqueue_write(type, path, std::move(payload), durability, [waiter](bool success) {
+        waiter->set_value(success);
+    });
+    return result;
+}
+
+
+void AsyncBatchWriter::enqueue_write(WriteType type, const std::string &path, std::string payload,
+                                     Durability durability,
+                                     AsyncBatchWriter::Completion on_complete) {
+    Worker& worker = worker_for(path);
+    WriteRequest request{type, path, std::move(payload), durability};
+    vector<PendingItem> dropped;
+    bool accepted;
+    {
+        unique_lock lock(worker.queue_mutex);
+        accepted = enqueue_locked(worker, lock, request, on_complete, dropped);
+    }
+
+    for (auto& item : dropped) {
+        complete(item, false);
+    }
+    if (!accepted && on_complete) {
+        on_complete(false);
+    }
+}
+
+
+future<vector<bool>> AsyncBatchWriter::enqueue_batch(vector<WriteRequest> requests) {
+    auto waiter = make_shared<promise<vector<bool>>>();
+    future<vector<bool>> result = waiter->get_future();
+
+    enqueue_batch(std::move(requests), [waiter](const vector<bool>& results) {
+        waiter->set_value(results);
+    });
+    return result;
+}
+
+
+void AsyncBatchWriter::enqueue_batch(vector<WriteRequest> requests, BatchCompletion on_complete) {
+    if (requests.empty()) {
+        if (on_complete) {
+            on_complete({});
+        }
+        return;
+    }
+
+    // 各请求在不同工作线程上完成, 最后一个完成的请求汇总结果后回调
+    struct BatchState {
+        mutex results_mutex;
+        vector<bool> results;
+        size_t remaining;
+        BatchCompletion on_complete;
+    };
+    auto state = make_shared<BatchState>();
+    state->results.assign(requests.size(), false);
+    state->remaining = requests.size();
+    state->on_complete = std::move(on_complete);
+
+    auto completion_for = [state](size_t index) -> Completion {
+        return [state, index](bool success) {
+            unique_lock lock(state->results_mutex);
+            state->results[index] = success;
+            if (--state->remaining > 0) {
+                return;
+            }
+            lock.unlock();
+            if (state->on_complete) {
+                state->on_complete(state->results);
+            }
+        };
+    };
+
+    // 按工作线程分组, 每个线程的队列只加锁一次, 同组请求进入同一批次; 不同组之间不保证同时执行或同时落盘
+    vector<vector<size_t>> by_worker(_workers.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        by_worker[worker_index(requests[i].path)].push_back(i);
+    }
+
+    vector<PendingItem> dropped;
+    vector<Completion> rejected;
+    for (size_t w = 0; w < by_worker.size(); ++w) {
+        if (by_worker[w].empty()) {
+            continue;
+        }
+        Worker& worker = *_workers[w];
+        unique_lock lock(worker.queue_mutex);
+        for (size_t index : by_worker[w]) {
+            Completion completion = completion_for(index);
+            if (!enqueue_locked(worker, lock, requests[index], completion, dropped)) {
+                rejected.push_back(std::move(completion));
+            }
+        }
+    }
+
+    for (auto& item : dropped) {
+        complete(item, false);
+    }
+    for (auto& completion : rejected) {
+        completion(false);
+    }
+}
+
+
+bool AsyncBatchWriter::enqueue_locked(Worker &worker, unique_lock<mutex> &lock, WriteRequest &request,
+                                      Completion &on_complete, vector<PendingItem> &dropped) {
+    _enqueued_count.fetch_add(1, memory_order_relaxed);
+    worker.enqueued_since_sample++;
+
+    bool accepted = false;
+    for (;;) {
+        // 同一路径仍有未出队的写入时直接合并, 每个路径在队列中最多保留一项
+        auto it = worker.pending_writes.find(request.path);
+        if (it != worker.pending_writes.end()) {
+            // 先写日志再合并, 合并会转移 payload; 重放时按顺序执行各条记录与合并后的结果一致
+            journal_locked(*it->second, request.type, request.path, request.payload, request.durability);
+            coalesce_locked(*it->second, request.type, request.payload, request.durability);
+            if (on_complete) {
+                it->second->waiters.push_back(std::move(on_complete));
+            }
+            return true;
+        }
+
+        bool waited = false;
+        accepted = acquire_slot_locked(worker, lock, dropped, waited);
+        // 阻塞等待期间同一路径可能已有新请求入队, 需要重新尝试合并
+        if (!accepted || !waited) {
+            break;
+        }
     }
 
-    _cv.notify_all();
-    if (_worker_thread.joinable()) {
-        _worker_thread.join();
+    if (!accepted) {
+        return false;
     }
+
+    PendingItem item;
+    item.request = std::move(request);
+    if (on_complete) {
+        item.waiters.push_back(std::move(on_complete));
+    }
+    item.enqueued_at = Clock::now();
+    item.keyed = true;
+    const WriteRequest& queued = item.request;
+    journal_locked(item, queued.type, queued.path, queued.payload, queued.durability);
+    worker.queue.push_back(std::move(item));
+    worker.pending_writes[worker.queue.back().request.path] = prev(worker.queue.end());
+    add_depth(1, 0);
+    notify_worker_locked(worker);
+    return true;
+}
+
+
+void AsyncBatchWriter::set_queue_limit(size_t max_pending, AsyncBatchWriter::OverflowPolicy policy) {
+    const size_t count = _workers.size();
+    _max_pending_per_worker = (max_pending + count - 1) / count;
+    _overflow_policy = policy;
+
+    for (auto& worker : _workers) {
+        lock_guard lock(worker->queue_mutex);
+        worker->space_cv.notify_all();
+    }
+}
+
+
+size_t AsyncBatchWriter::queue_depth() const {
+    return _queue_depth.load(memory_order_relaxed);
+}
+
+
+size_t AsyncBatchWriter::worker_count() const {
+    return _workers.size();
+}
+
+
+void AsyncBatchWriter::flush() {
+    for (auto& worker : _workers) {
+        unique_lock lock(worker->queue_mutex);
+        // flush 期间不再等待截止时间, 剩余请求立即出队
+        worker->flush_requests++;
+        worker->cv.notify_one();
+        worker->idle_cv.wait(lock, [&] {
+            return (worker->queue.empty() && !worker->busy) || _stop_flag.load(memory_order_relaxed);
+        });
+        worker->flush_requests--;
+    }
+}
+
+
+void AsyncBatchWriter::set_write_handler(AsyncBatchWriter::WriteHandler handler) {
+    _write_handler = std::move(handler);
+}
+
+
+void AsyncBatchWriter::set_durable_handler(AsyncBatchWriter::DurableHandler handler) {
+    _durable_handler = std::move(handler);
+}
+
+
+void AsyncBatchWriter::set_batch_all_writes(bool enabled) {
+    _batch_all_writes.store(enabled, memory_order_relaxed);
+}
+
+
+void AsyncBatchWriter::set_journal(WriteAheadJournal *journal) {
+    _journal = journal;
 }
 
 
-void AsyncBatchWriter::enqueue(AsyncBatchWriter::Task task) {
-    lock_guard lock(_mutex);
-    _queue.push(std::move(task));
-    //唤醒工作线程
-    _cv.notify_one();
+AsyncBatchWriter::Stats AsyncBatchWriter::get_stats() const {
+    Stats stats;
+    stats.enqueued = _enqueued_count.load(memory_order_relaxed);
+    stats.executed = _executed_count.load(memory_order_relaxed);
+    stats.coalesced = _coalesced_count.load(memory_order_relaxed);
+    stats.cancelled = _cancelled_count.load(memory_order_relaxed);
+    stats.durable_commits = _durable_commit_count.load(memory_order_relaxed);
+    stats.rejected = _rejected_count.load(memory_order_relaxed);
+    stats.dropped = _dropped_count.load(memory_order_relaxed);
+    stats.blocked = _blocked_count.load(memory_order_relaxed);
+    stats.queue_depth = _queue_depth.load(memory_order_relaxed);
+    stats.peak_queue_depth = _peak_queue_depth.load(memory_order_relaxed);
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        stats.latency_histogram[i] = _latency_histogram[i].load(memory_order_relaxed);
+    }
+    stats.latency_sum_us = _latency_sum_us.load(memory_order_relaxed);
+    stats.unjournaled = _unjournaled_count.load(memory_order_relaxed);
+    return stats;
 }
 
 void AsyncBatchWriter::set_batch_params(size_t min_batch, size_t max_batch,
                                         AsyncBatchWriter::Duration interval,
                                         AsyncBatchWriter::Duration max_wait) {
-    lock_guard lock(_mutex);
     _min_batch_size = min_batch;
-    _max_batch_size = max_batch;
-    _batch_interval = interval.count();
-    _max_wait_time = max_wait.count();
+    _max_batch_size = max<size_t>(1, max_batch);
+    _max_wait_time = static_cast<int>(max_wait.count());
+
+    for (auto& worker : _workers) {
+        lock_guard lock(worker->queue_mutex);
+        worker->linger = min(interval, max_wait);
+    }
 }
 
 void AsyncBatchWriter::enable_adaptive_mode(bool enable) {
     _adaptive_mode = enable;
 }
 
-void AsyncBatchWriter::worker_loop() {
-    vector<Task> batch;
-    TimePoint last_flush_time = Clock::now();
+void AsyncBatchWriter::worker_loop(Worker& worker) {
+    vector<PendingItem> batch;
 
     while (!_stop_flag.load(memory_order_relaxed)) {
         batch.clear();
 
-        collect_batch(batch);
+        collect_batch(worker, batch);
 
         if (!batch.empty()) {
+            TimePoint start = Clock::now();
             execute_batch(batch);
 
             if (_adaptive_mode) {
-                adjust_parameters(batch.size());
+                adjust_parameters(worker, Clock::now() - start);
             }
         }
+
+        lock_guard lock(worker.queue_mutex);
+        worker.busy = false;
+        worker.idle_cv.notify_all();
     }
 }
 
 
-void AsyncBatchWriter::collect_batch(vector<AsyncBatchWriter::Task> &batch) {
-    unique_lock lock(_mutex);
+void AsyncBatchWriter::collect_batch(Worker& worker, vector<AsyncBatchWriter::PendingItem> &batch) {
+    unique_lock lock(worker.queue_mutex);
+
+    // 队列为空时一直等到有请求入队, 不做定时空转
+    worker.cv.wait(lock, [&] {
+        return _stop_flag.load(memory_order_relaxed) || !worker.queue.empty();
+    });
+
+    const size_t max_batch = _max_batch_size;
+    auto ready = [&] {
+        return _stop_flag.load(memory_order_relaxed) || worker.flush_requests > 0 ||
+               worker.queue.size() >= max_batch;
+    };
 
-    if (_queue.empty()) {
-        _cv.wait_for(lock, chrono::milliseconds(_batch_interval));
+    // 批次未满时等到最旧请求的截止时间; 入队使批次装满或 flush 时提前唤醒
+    if (!ready()) {
+        const Clock::duration linger = _adaptive_mode
+                                       ? worker.linger
+                                       : Clock::duration(chrono::milliseconds(_max_wait_time.load()));
+        worker.cv.wait_until(lock, worker.queue.front().enqueued_at + linger, ready);
     }
 
-    if (batch.size() < _min_batch_size) {
-        auto wait_time = min<int>(_batch_interval, _max_wait_time - static_cast<int>(batch.size()));
+    while (batch.size() < max_batch && !worker.queue.empty()) {
+        auto front = worker.queue.begin();
+        if (front->keyed) {
+            // 出队后不再参与合并, 之后的同路径写入按顺序排在其后
+            worker.pending_writes.erase(front->request.path);
+        }
+        batch.push_back(std::move(*front));
+        worker.queue.pop_front();
+    }
+    worker.busy = !batch.empty();
+    add_depth(0, batch.size());
+    worker.space_cv.notify_all();
+}
 
-        if (wait_time > 0) {
-            _cv.wait_for(lock, chrono::milliseconds(wait_time));
+
+void AsyncBatchWriter::notify_worker_locked(Worker &worker) {
+    // 只有队列由空变为非空, 或批次刚好装满时工作线程才需要被唤醒
+    const size_t size = worker.queue.size();
+    if (size == 1 || size == _max_batch_size.load(memory_order_relaxed)) {
+        worker.cv.notify_one();
+    }
+}
+
+
+void AsyncBatchWriter::execute_batch(std::vector<PendingItem> &batch) {
+    // 每个路径在批次内最多出现一次, 需要落盘的写入延后到批次末尾统一提交不会打乱同一文件的顺序
+    vector<PendingItem*> durable_items;
+    const bool batch_all = _batch_all_writes.load(memory_order_relaxed);
+
+    for (auto& item : batch) {
+        if (!item.keyed) {
+            try {
+                item.task();
+            } catch (...) {
+
+            }
+            record_latency(item, Clock::now());
+            _executed_count.fetch_add(1, memory_order_relaxed);
+            continue;
         }
 
-        while (batch.size() < _max_batch_size && !_queue.empty()) {
-            batch.push_back(std::move(_queue.front()));
-            _queue.pop();
+        if ((batch_all || item.request.durability != Durability::NONE) && _durable_handler) {
+            durable_items.push_back(&item);
+            continue;
         }
+
+        complete(item, execute_write(item.request));
+        record_latency(item, Clock::now());
+        _executed_count.fetch_add(1, memory_order_relaxed);
+    }
+
+    if (durable_items.empty()) {
+        return;
     }
 
+    vector<const WriteRequest*> requests;
+    requests.reserve(durable_items.size());
+    for (auto* item : durable_items) {
+        requests.push_back(&item->request);
+    }
+
+    vector<bool> results;
+    try {
+        results = _durable_handler(requests);
+    } catch (...) {
+
+    }
+    _durable_commit_count.fetch_add(1, memory_order_relaxed);
+
+    const TimePoint now = Clock::now();
+    for (size_t i = 0; i < durable_items.size(); ++i) {
+        complete(*durable_items[i], i < results.size() && results[i]);
+        record_latency(*durable_items[i], now);
+        _executed_count.fetch_add(1, memory_order_relaxed);
+    }
 }
 
 
-void AsyncBatchWriter::execute_batch(const std::vector<Task> &batch) {
-    for (const auto& task : batch) {
+bool AsyncBatchWriter::execute_write(const WriteRequest &request) {
+    if (!_write_handler) {
+        return false;
+    }
+    try {
+        return _write_handler(request);
+    } catch (...) {
+        return false;
+    }
+}
+
+
+void AsyncBatchWriter::complete(PendingItem &item, bool success) {
+    for (auto& waiter : item.waiters) {
         try {
-            task();
+            waiter(success);
         } catch (...) {
 
         }
     }
+    item.waiters.clear();
+}
+
+
+bool AsyncBatchWriter::acquire_slot_locked(Worker& worker, unique_lock<mutex> &lock,
+                                           vector<PendingItem> &dropped, bool &waited) {
+    auto has_room = [&] {
+        const size_t limit = _max_pending_per_worker.load(memory_order_relaxed);
+        return limit == 0 || worker.queue.size() < limit;
+    };
+
+    if (has_room()) {
+        return true;
+    }
+
+    switch (_overflow_policy.load(memory_order_relaxed)) {
+        case OverflowPolicy::BLOCK:
+            _blocked_count.fetch_add(1, memory_order_relaxed);
+            worker.space_cv.wait(lock, [&] {
+                return _stop_flag.load(memory_order_relaxed) || has_room();
+            });
+            waited = true;
+            return has_room();
+
+        case OverflowPolicy::REJECT:
+            _rejected_count.fetch_add(1, memory_order_relaxed);
+            return false;
+
+        case OverflowPolicy::DROP_OLDEST: {
+            auto front = worker.queue.begin();
+            if (front->keyed) {
+                worker.pending_writes.erase(front->request.path);
+            }
+            dropped.push_back(std::move(*front));
+            worker.queue.pop_front();
+            add_depth(0, 1);
+            _dropped_count.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void AsyncBatchWriter::add_depth(size_t added, size_t removed) {
+    size_t depth = _queue_depth.fetch_add(added, memory_order_relaxed) + added;
+    if (removed > 0) {
+        depth = _queue_depth.fetch_sub(removed, memory_order_relaxed) - removed;
+    }
+
+    size_t peak = _peak_queue_depth.load(memory_order_relaxed);
+    while (depth > peak &&
+           !_peak_queue_depth.compare_exchange_weak(peak, depth, memory_order_relaxed)) {
+    }
+}
+
+
+AsyncBatchWriter::Worker &AsyncBatchWriter::worker_for(const std::string &path) {
+    return *_workers[worker_index(path)];
+}
+
+
+size_t AsyncBatchWriter::worker_index(const std::string &path) const {
+    return hash<string>{}(path) % _workers.size();
 }
 
-void AsyncBatchWriter::adjust_parameters(size_t batch_size) {
-    if (batch_size >= _max_batch_size) {
-        _batch_interval = std::min(250, _batch_interval + 5);
-    } else if (batch_size < _min_batch_size) {
-        _batch_interval = std::max(10, _batch_interval - 2);
+
+void AsyncBatchWriter::journal_locked(PendingItem &item, WriteType type, const std::string &path,
+                                      const std::string &payload, Durability durability) {
+    if (_journal == nullptr) {
+        return;
+    }
+
+    uint64_t seq = 0;
+    if (!_journal->append(type, path, payload, durability, seq)) {
+        // 日志空间不足时仍然执行写入, 只是不再保证进程被杀后可重放
+        _unjournaled_count.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    WriteAheadJournal* journal = _journal;
+    item.waiters.push_back([journal, seq](bool) {
+        journal->release(seq);
+    });
+}
+
+
+void AsyncBatchWriter::coalesce_locked(PendingItem &pending, WriteType type, std::string &payload,
+                                       Durability durability) {
+    WriteRequest& request = pending.request;
+    // 合并后的请求取所有参与者中最高的持久化级别
+    request.durability = max(request.durability, durability);
+
+    switch (type) {
+        case WriteType::CREATE:
+        case WriteType::UPDATE:
+            // 整体写入覆盖之前所有未执行的写入
+            request.type = type;
+            request.payload = std::move(payload);
+            _coalesced_count.fetch_add(1, memory_order_relaxed);
+            return;
+
+        case WriteType::APPEND:
+            if (request.type == WriteType::DELETE) {
+                // 删除后追加等价于以追加内容整体写入
+                request.type = WriteType::UPDATE;
+                request.payload = std::move(payload);
+            } else {
+                request.payload.append(payload);
+            }
+            _coalesced_count.fetch_add(1, memory_order_relaxed);
+            return;
+
+        case WriteType::DELETE:
+            if (request.type == WriteType::DELETE) {
+                _coalesced_count.fetch_add(1, memory_order_relaxed);
+            } else {
+                _cancelled_count.fetch_add(1, memory_order_relaxed);
+            }
+            request.type = WriteType::DELETE;
+            request.payload.clear();
+            return;
+    }
+}
+
+void AsyncBatchWriter::adjust_parameters(Worker& worker, Clock::duration write_latency) {
+    constexpr double ALPHA = 0.2;
+
+    lock_guard lock(worker.queue_mutex);
+    const TimePoint now = Clock::now();
+    const double elapsed_ms = chrono::duration<double, milli>(now - worker.sample_start).count();
+    if (elapsed_ms > 0) {
+        const double rate = static_cast<double>(worker.enqueued_since_sample) / elapsed_ms;
+        worker.enqueue_rate += ALPHA * (rate - worker.enqueue_rate);
+    }
+    worker.enqueued_since_sample = 0;
+    worker.sample_start = now;
+
+    const double latency_ms = chrono::duration<double, milli>(write_latency).count();
+    worker.write_latency_ms += ALPHA * (latency_ms - worker.write_latency_ms);
+
+    // 按当前速率装满一个批次所需的时间, 不超过 max_wait
+    const double max_wait = _max_wait_time.load(memory_order_relaxed);
+    double linger = max_wait;
+    if (worker.enqueue_rate > 0) {
+        linger = min(max_wait, static_cast<double>(_max_batch_size) / worker.enqueue_rate);
+    }
+    // 流量稀疏时等满 max_wait 也凑不出 min_batch, 等待只会增加延迟
+    if (worker.enqueue_rate * max_wait < static_cast<double>(_min_batch_size)) {
+        linger = 0;
+    }
+    // 执行上一批期间新请求已经在积压, 这部分时间不必再等
+    linger = max(0.0, linger - worker.write_latency_ms);
+
+    worker.linger = chrono::duration_cast<Clock::duration>(chrono::duration<double, milli>(linger));
+}
+
+
+void AsyncBatchWriter::record_latency(const PendingItem &item, TimePoint now) {
+    const auto latency_us = static_cast<uint64_t>(
+            chrono::duration_cast<chrono::microseconds>(now - item.enqueued_at).count());
+
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKET_BOUNDS_US.size() && latency_us > LATENCY_BUCKET_BOUNDS_US[bucket]) {
+        ++bucket;
     }
+    _latency_histogram[bucket].fetch_add(1, memory_order_relaxed);
+    _latency_sum_us.fetch_add(latency_us, memory_order_relaxed);
 }
\ No newline at end of file
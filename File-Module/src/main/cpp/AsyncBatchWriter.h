@@ -7,18 +7,33 @@
 
 #include <functional>
 #include <vector>
-#include <queue>
+#include <list>
+#include <string>
+#include <unordered_map>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <chrono>
 #include <algorithm>
+#include <future>
+#include <memory>
+#include <array>
+#include "FileWriteTypes.h"
+#include "WriteAheadJournal.h"
 
 using namespace std;
 
 /**
  *  异步批处理
+ *  按路径写入的请求在出队前会合并: 后到的 update 覆盖之前未执行的写入, 连续 append 合并为一次写入,
+ *  delete 取消该路径上所有未执行的写入
+ *  同一批次内 ORDERED/DURABLE 级别的写入交给 DurableHandler 统一提交, 共用一次落盘;
+ *  开启 batch_all_writes 后 NONE 级别的写入同样整批提交, 供能够批量提交 I/O 的后端使用
+ *  队列有上限, 队满时按 OverflowPolicy 阻塞生产者, 拒绝新请求或丢弃最旧的请求; 合并进已有请求的写入不占用队列
+ *  多个工作线程各自持有独立队列, 写入按路径哈希路由, 同一文件的写入始终由同一线程按顺序执行
+ *  设置预写日志后, 请求在入队时先写入日志, 执行完成后释放对应记录
+ *  批次在装满 max_batch 或最旧请求等待超过截止时间时出队; 自适应模式根据实测入队速率与写入耗时调整截止时间
  */
 class AsyncBatchWriter {
 
@@ -28,38 +43,200 @@ public:
     using TimePoint = Clock::time_point;
     using Duration = chrono::milliseconds;
 
-    AsyncBatchWriter();
+    // 写入完成回调, 在工作线程上执行
+    using Completion = function<void(bool)>;
+
+    enum class OverflowPolicy {
+        BLOCK,          // 阻塞生产者直到队列有空位
+        REJECT,         // 新请求直接以失败完成
+        DROP_OLDEST     // 丢弃队首最旧的请求, 其完成结果为失败
+    };
+
+    static constexpr size_t DEFAULT_MAX_PENDING = 4096;
+
+    // 入队到执行完成的延迟分布, 第 i 个桶统计不超过 LATENCY_BUCKET_BOUNDS_US[i] 微秒的请求, 最后一个桶统计超过 1 秒的请求
+    static constexpr size_t LATENCY_BUCKETS = 12;
+    static constexpr array<uint32_t, LATENCY_BUCKETS - 1> LATENCY_BUCKET_BOUNDS_US = {
+            250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+    };
+
+    struct WriteRequest {
+        WriteType type;
+        string path;
+        string payload;
+        Durability durability = Durability::NONE;
+    };
+
+    using WriteHandler = function<bool(const WriteRequest&)>;
+
+    // 批量提交需要落盘的写入, 按顺序返回每个请求的结果
+    using DurableHandler = function<vector<bool>(const vector<const WriteRequest*>&)>;
+
+    // 批量写入完成回调, 按提交顺序给出每个请求的结果
+    using BatchCompletion = function<void(const vector<bool>&)>;
+
+    struct Stats {
+        uint64_t enqueued = 0;
+        uint64_t executed = 0;
+        uint64_t coalesced = 0;     // 被后续写入覆盖或合并掉的写入次数
+        uint64_t cancelled = 0;     // 被 delete 取消的写入次数
+        uint64_t durable_commits = 0; // 交给 DurableHandler 的批量提交次数
+        uint64_t rejected = 0;      // 队满被拒绝的请求数
+        uint64_t dropped = 0;       // 队满被丢弃的旧请求数
+        uint64_t blocked = 0;       // 队满时生产者被阻塞的次数
+        size_t queue_depth = 0;     // 当前排队的请求数
+        size_t peak_queue_depth = 0;
+        array<uint64_t, LATENCY_BUCKETS> latency_histogram{};
+        uint64_t latency_sum_us = 0;
+        uint64_t unjournaled = 0;   // 日志空间不足, 未写入日志的请求数
+    };
+
+    explicit AsyncBatchWriter(size_t worker_count = 1);
 
     ~AsyncBatchWriter();
 
-    void enqueue(Task task);
+    // 队满且策略为 REJECT 时返回 false
+    bool enqueue(Task task);
 
+    // 返回的 future 在写入按 durability 级别完成后就绪; 被合并的写入与合并后的请求共享结果
+    future<bool> enqueue_write(WriteType type, const string& path, string payload,
+                               Durability durability = Durability::NONE);
+
+    // 回调形式, 被拒绝时在调用线程上立即以 false 回调
+    void enqueue_write(WriteType type, const string& path, string payload,
+                       Durability durability, Completion on_complete);
+
+    // 批量提交: 按工作线程分组后每组只加锁一次入队, 全部完成后回调一次; 与逐个 enqueue_write 的合并与顺序语义相同
+    // 请求仍按路径路由, 以保持与单个写入之间的同路径顺序; 多个工作线程时整批不是原子的,
+    // 各线程上的部分分别执行与落盘, 结果按请求逐个给出, 部分失败不影响其余请求
+    future<vector<bool>> enqueue_batch(vector<WriteRequest> requests);
+
+    void enqueue_batch(vector<WriteRequest> requests, BatchCompletion on_complete);
+
+    // max_pending 为所有工作线程合计的上限, 平均分给每个线程; 为 0 表示不限制队列长度
+    void set_queue_limit(size_t max_pending, OverflowPolicy policy);
+
+    size_t queue_depth() const;
+
+    size_t worker_count() const;
+
+    // 阻塞直到此前入队的请求全部执行完成
+    void flush();
+
+    // 处理器需在首次入队前设置
+    void set_write_handler(WriteHandler handler);
+
+    void set_durable_handler(DurableHandler handler);
+
+    // 为 true 时批次内所有按路径的写入都交给 DurableHandler, 可在运行中切换
+    void set_batch_all_writes(bool enabled);
+
+    // 日志由调用方持有, 生命周期需长于写入器; 需在首次入队前设置
+    void set_journal(WriteAheadJournal* journal);
+
+    Stats get_stats() const;
+
+    // max_batch: 批次装满即出队; max_wait: 最旧请求的最长等待时间; interval: 自适应模式的初始等待时间;
+    // min_batch: 自适应模式下, 按实测速率在 max_wait 内凑不满 min_batch 时不再等待, 直接出队
     void set_batch_params(size_t min_batch, size_t max_batch, Duration interval, Duration max_wait);
 
     void enable_adaptive_mode(bool enable);
 
 
 private:
-    void worker_loop();
+    struct PendingItem {
+        Task task;
+        WriteRequest request;
+        vector<Completion> waiters;
+        TimePoint enqueued_at;
+        bool keyed = false;
+    };
 
-    void collect_batch(vector<Task>& batch);
+    using PendingList = list<PendingItem>;
 
-    void execute_batch(const std::vector<Task>& batch);
+    struct Worker {
+        thread worker_thread;
+        PendingList queue;
+        unordered_map<string, PendingList::iterator> pending_writes;
+        mutex queue_mutex;
+        condition_variable cv;
+        condition_variable space_cv;
+        condition_variable idle_cv;
+        bool busy = false;
+        size_t flush_requests = 0;
 
-    void adjust_parameters(size_t batch_size);
+        Clock::duration linger{};
+        uint64_t enqueued_since_sample = 0;
+        TimePoint sample_start;
+        double enqueue_rate = 0;        // 每毫秒入队数
+        double write_latency_ms = 0;    // 每批执行耗时
+    };
 
+    void worker_loop(Worker& worker);
 
-    thread _worker_thread;
-    queue<Task> _queue;
-    mutex _mutex;
-    condition_variable _cv;
-    atomic<bool> _stop_flag;
+    void collect_batch(Worker& worker, vector<PendingItem>& batch);
+
+    void execute_batch(std::vector<PendingItem>& batch);
 
-    size_t _max_batch_size;
-    size_t _min_batch_size;
-    int _batch_interval;
-    int _max_wait_time;
-    bool _adaptive_mode;
+    bool execute_write(const WriteRequest& request);
+
+    static void complete(PendingItem& item, bool success);
+
+    bool acquire_slot_locked(Worker& worker, unique_lock<mutex>& lock,
+                             vector<PendingItem>& dropped, bool& waited);
+
+    void add_depth(size_t added, size_t removed);
+
+    void adjust_parameters(Worker& worker, Clock::duration write_latency);
+
+    void record_latency(const PendingItem& item, TimePoint now);
+
+    void coalesce_locked(PendingItem& pending, WriteType type, string& payload,
+                         Durability durability);
+
+    void journal_locked(PendingItem& item, WriteType type, const string& path,
+                        const string& payload, Durability durability);
+
+    // 被合并或入队时返回 true 并取走 on_complete; 被拒绝时保留 on_complete 由调用方在解锁后回调
+    bool enqueue_locked(Worker& worker, unique_lock<mutex>& lock, WriteRequest& request,
+                        Completion& on_complete, vector<PendingItem>& dropped);
+
+    Worker& worker_for(const string& path);
+
+    size_t worker_index(const string& path) const;
+
+    void notify_worker_locked(Worker& worker);
+
+
+    vector<unique_ptr<Worker>> _workers;
+    WriteHandler _write_handler;
+    DurableHandler _durable_handler;
+    atomic<bool> _batch_all_writes{false};
+    WriteAheadJournal* _journal = nullptr;
+    atomic<bool> _stop_flag;
+    atomic<size_t> _next_task_worker{0};
+
+    atomic<size_t> _max_batch_size;
+    atomic<size_t> _min_batch_size;
+    atomic<int> _max_wait_time;
+    atomic<bool> _adaptive_mode;
+
+    atomic<size_t> _max_pending_per_worker;
+    atomic<OverflowPolicy> _overflow_policy;
+
+    atomic<uint64_t> _enqueued_count{0};
+    atomic<uint64_t> _executed_count{0};
+    atomic<uint64_t> _coalesced_count{0};
+    atomic<uint64_t> _cancelled_count{0};
+    atomic<uint64_t> _durable_commit_count{0};
+    atomic<uint64_t> _rejected_count{0};
+    atomic<uint64_t> _dropped_count{0};
+    atomic<uint64_t> _blocked_count{0};
+    atomic<size_t> _queue_depth{0};
+    atomic<size_t> _peak_queue_depth{0};
+    array<atomic<uint64_t>, LATENCY_BUCKETS> _latency_histogram{};
+    atomic<uint64_t> _latency_sum_us{0};
+    atomic<uint64_t> _unjournaled_count{0};
 };
 
 
@@ -3,54 +3,244 @@
 //
 
 #include "AtomicFileOperator.h"
+#include "DirectoryScanner.h"
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <csignal>
+
+MappedFile::MappedFile(FileLockManager::LockPtr lock, void *addr, size_t size)
+        : _lock(std::move(lock)), _addr(addr), _size(size) {}
+
+MappedFile::~MappedFile() {
+    if (_addr != nullptr) {
+        munmap(_addr, _size);
+    }
+    // pin 不绑定线程, 视图可以在任意线程(例如 Java 侧)释放
+    _lock->unpin();
+}
 
-AtomicFileOperator::AtomicFileOperator(FileLockManager &lock_manager) : _lock_manager(
-        lock_manager) {}
 
-bool AtomicFileOperator::create_file(const std::string &path, const std::string &content) {
-    auto lock = _lock_manager.get_lock(path);
+FileReadStream::FileReadStream(FileLockManager::LockPtr lock, int fd, uint64_t size)
+        : _lock(std::move(lock)), _fd(fd), _size(size) {}
 
-    unique_lock exclusive_lock(*lock);
+FileReadStream::~FileReadStream() {
+    close(_fd);
+    _lock->unpin();
+}
+
+ssize_t FileReadStream::read(char *buffer, size_t size) {
+    while (true) {
+        ssize_t n = pread(_fd, buffer, size, static_cast<off_t>(_position));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n > 0) {
+            _position += static_cast<uint64_t>(n);
+        }
+        return n;
+    }
+}
+
+
+FileWriteStream::FileWriteStream(FileLockManager &lock_manager, string path, string temp_path, int fd)
+        : _lock_manager(lock_manager), _path(std::move(path)), _temp_path(std::move(temp_path)), _fd(fd) {}
+
+FileWriteStream::~FileWriteStream() {
+    discard();
+}
+
+bool FileWriteStream::write(const char *data, size_t size) {
+    if (_fd == -1 || _failed) {
+        return false;
+    }
+    if (!AtomicFileOperator::write_fully(_fd, data, size)) {
+        _failed = true;
+        return false;
+    }
+    _size += size;
+    return true;
+}
+
+bool FileWriteStream::commit(Durability durability) {
+    if (_fd == -1) {
+        return false;
+    }
+    bool success = !_failed;
+    // 数据先落盘, rename 之后掉电也不会看到不完整的内容
+    if (success && durability != Durability::NONE) {
+        success = fdatasync(_fd) == 0;
+    }
+    success = close(_fd) == 0 && success;
+    _fd = -1;
+
+    if (success) {
+        auto lock = _lock_manager.get_lock(_path);
+        success = lock->lock();
+        if (success) {
+            unique_lock exclusive_lock(*lock, adopt_lock);
+            AtomicFileOperator::settle_append_journal(_path);
+            success = rename(_temp_path.c_str(), _path.c_str()) == 0;
+        }
+    }
+    if (success) {
+        _temp_path.clear();
+        if (durability == Durability::DURABLE) {
+            success = AtomicFileOperator::sync_directory(filesystem::path(_path).parent_path().string());
+        }
+    } else {
+        unlink(_temp_path.c_str());
+        _temp_path.clear();
+    }
+
+    if (_on_commit) {
+        _on_commit(_path, success);
+    }
+    return success;
+}
+
+void FileWriteStream::set_commit_callback(FileWriteStream::CommitCallback on_commit) {
+    _on_commit = std::move(on_commit);
+}
+
+void FileWriteStream::discard() {
+    if (_fd != -1) {
+        close(_fd);
+        _fd = -1;
+    }
+    if (!_temp_path.empty()) {
+        unlink(_temp_path.c_str());
+        _temp_path.clear();
+    }
+}
 
-    ensure_parent_directory(path);
 
-    ofstream file(path, ios::binary);
-    if (!file) {
+AtomicFileOperator::AtomicFileOperator(FileLockManager &lock_manager)
+        : _lock_manager(lock_manager), _io_backend(make_shared<SyncIoBackend>()) {}
+
+bool AtomicFileOperator::create_file(const std::string &path, const std::string &content,
+                                     Durability durability) {
+    if (durability != Durability::NONE) {
+        return commit_single(WriteType::CREATE, path, content, durability);
+    }
+
+    auto lock = _lock_manager.get_lock(path);
+    if (!lock->lock()) {
         return false;
     }
+    unique_lock exclusive_lock(*lock, adopt_lock);
 
-    file.write(content.data(), content.size());
-    return file.good();
+    ensure_parent_directory(path);
+    settle_append_journal(path);
+    return write_file_locked(path, content);
 }
 
 bool AtomicFileOperator::read_file(const std::string &path, std::string &output) {
     auto lock = _lock_manager.get_lock(path);
-    shared_lock shared_lock(*lock);
+    if (!lock->lock_shared()) {
+        return false;
+    }
+    shared_lock shared_lock(*lock, adopt_lock);
 
-    if (filesystem::file_size(path) > MMAP_THRESHOLD) {
-        return mmap_read(path, output);
+    // 一次 open 与 fstat 取得大小, 之后的读取复用同一个 fd; 文件不存在时返回 false
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat sb;
+    bool success = fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode);
+    if (success) {
+        const auto size = static_cast<size_t>(sb.st_size);
+        success = size > MMAP_THRESHOLD ? mmap_read(fd, size, output) : pread_fully(fd, size, output);
     }
-    return stream_read(path, output);
+    close(fd);
+    return success;
 }
 
-bool AtomicFileOperator::update_file(const std::string &path, const std::string &content) {
+AtomicFileOperator::ReadStream AtomicFileOperator::open_read_stream(const std::string &path) {
     auto lock = _lock_manager.get_lock(path);
-    unique_lock exclusive_lock(*lock);
+    if (!lock->pin()) {
+        return nullptr;
+    }
 
-    // 原子更新策略：写入临时文件后重命名
-    string temp_path = path + ".tmp";
-    {
-        ensure_parent_directory(temp_path);
-        ofstream file(temp_path, ios::binary);
-        if (!file) {
-            return false;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat sb;
+    if (fd == -1 || fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode)) {
+        if (fd != -1) {
+            close(fd);
         }
-        file.write(content.data(), content.size());
-        if  (!file.good()) {
-            filesystem::remove(temp_path);
-            return false;
+        lock->unpin();
+        return nullptr;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // 锁的所有权转移给流, 由析构时释放
+    return ReadStream(new FileReadStream(std::move(lock), fd, static_cast<uint64_t>(sb.st_size)));
+}
+
+AtomicFileOperator::WriteStream AtomicFileOperator::open_write_stream(const std::string &path) {
+    static atomic<uint32_t> sequence{0};
+
+    if (is_internal_name(filesystem::path(path).filename().string())) {
+        return nullptr;
+    }
+    ensure_parent_directory(path);
+    const string pid = to_string(getpid()) + "-";
+    // 同一进程内序号递增, 仍然冲突 (例如上次进程的残留恰好同名) 时换下一个
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        string temp_path = internal_path(path, pid + to_string(sequence.fetch_add(1, memory_order_relaxed)) + "-",
+                                         STREAM_SUFFIX);
+        int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd != -1) {
+            return WriteStream(new FileWriteStream(_lock_manager, path, std::move(temp_path), fd));
+        }
+        if (errno != EEXIST) {
+            break;
         }
     }
+    return nullptr;
+}
+
+AtomicFileOperator::MappedView AtomicFileOperator::map_file(const std::string &path,
+                                                            MappedFile::Advice advice) {
+    auto lock = _lock_manager.get_lock(path);
+    if (!lock->pin()) {
+        return nullptr;
+    }
+
+    size_t size = 0;
+    void* addr = map_region(path, size, advice);
+    if (addr == MAP_FAILED) {
+        lock->unpin();
+        return nullptr;
+    }
+
+    // 锁的所有权转移给视图, 由 MappedFile 析构时释放
+    return MappedView(new MappedFile(std::move(lock), addr, size));
+}
+
+bool AtomicFileOperator::update_file(const std::string &path, const std::string &content,
+                                     Durability durability) {
+    if (durability != Durability::NONE) {
+        return commit_single(WriteType::UPDATE, path, content, durability);
+    }
+
+    auto lock = _lock_manager.get_lock(path);
+    if (!lock->lock()) {
+        return false;
+    }
+    unique_lock exclusive_lock(*lock, adopt_lock);
+    settle_append_journal(path);
+
+    // 原子更新策略：写入临时文件后重命名
+    string temp_path = temp_path_for(path);
+    ensure_parent_directory(temp_path);
+    if (!write_file_locked(temp_path, content)) {
+        filesystem::remove(temp_path);
+        return false;
+    }
 
     if (rename(temp_path.c_str(), path.c_str()) != 0) {
         filesystem::remove(temp_path);
@@ -59,39 +249,82 @@ bool AtomicFileOperator::update_file(const std::string &path, const std::string
     return true;
 }
 
-bool AtomicFileOperator::append_file_safely(const std::string &path, const std::string &content) {
+bool AtomicFileOperator::append_file_safely(const std::string &path, const std::string &content,
+                                            Durability durability) {
+    if (durability != Durability::NONE) {
+        return commit_single(WriteType::APPEND, path, content, durability);
+    }
+
     auto lock = _lock_manager.get_lock(path);
-    unique_lock exclusive_lock(*lock);
+    if (!lock->lock()) {
+        return false;
+    }
+    unique_lock exclusive_lock(*lock, adopt_lock);
+    return append_locked(path, content);
+}
 
-    string temp_path = path + ".tmp";
-    {
-        ensure_parent_directory(temp_path);
-        ofstream file(temp_path, ios::binary);
-        if (!file) {
-            return false;
-        }
-        if (!copy_file(path, temp_path)) {
-            filesystem::remove(temp_path);
-            return false;
-        }
+bool AtomicFileOperator::append_locked(const std::string &path, const std::string &content) {
+    ensure_parent_directory(path);
 
-        if (!append_file(temp_path, content)) {
-            filesystem::remove(temp_path);
-            return false;
-        }
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return false;
     }
 
-    if (rename(temp_path.c_str(), path.c_str()) != 0) {
-        filesystem::remove(temp_path);
+    // 意图日志: 先记录追加前的长度, 追加完成后删除; 日志残留说明上次追加中途崩溃
+    const string journal_path = internal_path(path, "", APPEND_JOURNAL_SUFFIX);
+    int journal_fd = open(journal_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (journal_fd == -1 && errno == EEXIST && recover_append(path, journal_path)) {
+        journal_fd = open(journal_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    }
+    if (journal_fd == -1) {
+        close(fd);
         return false;
     }
 
-    return true;
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        close(journal_fd);
+        unlink(journal_path.c_str());
+        close(fd);
+        return false;
+    }
+
+    AppendIntent intent{APPEND_JOURNAL_MAGIC, 0, static_cast<uint64_t>(sb.st_size),
+                        static_cast<uint64_t>(sb.st_dev), static_cast<uint64_t>(sb.st_ino)};
+    bool journaled = write_fully(journal_fd, reinterpret_cast<const char*>(&intent), sizeof(intent));
+    close(journal_fd);
+    if (!journaled) {
+        unlink(journal_path.c_str());
+        close(fd);
+        return false;
+    }
+
+    bool success = write_fully(fd, content.data(), content.size());
+    if (!success) {
+        // 部分写入时回滚到追加前的长度
+        if (ftruncate(fd, sb.st_size) != 0) {
+            close(fd);
+            return false;
+        }
+    }
+
+    close(fd);
+    unlink(journal_path.c_str());
+    return success;
 }
 
-bool AtomicFileOperator::delete_file(const std::string &path) {
+bool AtomicFileOperator::delete_file(const std::string &path, Durability durability) {
+    if (durability != Durability::NONE) {
+        return commit_single(WriteType::DELETE, path, "", durability);
+    }
+
     auto lock = _lock_manager.get_lock(path);
-    unique_lock exclusive_lock(*lock);
+    if (!lock->lock()) {
+        return false;
+    }
+    unique_lock exclusive_lock(*lock, adopt_lock);
+    settle_append_journal(path);
 
     error_code ec;
     return filesystem::remove(path, ec);
@@ -100,13 +333,28 @@ bool AtomicFileOperator::delete_file(const std::string &path) {
 
 bool AtomicFileOperator::file_exists(const std::string &path) {
     auto lock = _lock_manager.get_lock(path);
-    shared_lock shared_lock(*lock);
+    if (!lock->lock_shared()) {
+        return false;
+    }
+    shared_lock shared_lock(*lock, adopt_lock);
 
     error_code  ec;
     return filesystem::exists(path, ec);
 }
 
 
+void AtomicFileOperator::set_io_backend(shared_ptr<IoBackend> backend) {
+    lock_guard lock(_backend_mutex);
+    _io_backend = std::move(backend);
+}
+
+
+shared_ptr<IoBackend> AtomicFileOperator::io_backend() const {
+    lock_guard lock(_backend_mutex);
+    return _io_backend;
+}
+
+
 void AtomicFileOperator::ensure_parent_directory(const std::string &path) {
     error_code ec;
     auto parent_path = filesystem::path(path).parent_path();
@@ -116,75 +364,393 @@ void AtomicFileOperator::ensure_parent_directory(const std::string &path) {
 }
 
 
-bool AtomicFileOperator::mmap_read(const std::string &path, std::string &output) {
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd == -1) {
+bool AtomicFileOperator::write_file_locked(const std::string &path, const std::string &content) {
+    return SyncIoBackend::write_file(path, content);
+}
+
+
+bool AtomicFileOperator::commit_single(WriteType type, const std::string &path,
+                                       const std::string &content, Durability durability) {
+    DurableWriteBatch batch(*this);
+    batch.add(type, path, content, durability);
+    return batch.commit().front();
+}
+
+
+bool AtomicFileOperator::mmap_read(int fd, size_t size, std::string &output) {
+    void* addr = map_fd(fd, size, MappedFile::Advice::SEQUENTIAL);
+    if (addr == MAP_FAILED) {
         return false;
     }
 
+    if (addr == nullptr) {
+        output.clear();
+        return true;
+    }
+
+    output.assign(static_cast<const char*>(addr), size);
+
+    munmap(addr, size);
+    return true;
+}
+
+
+void *AtomicFileOperator::map_region(const std::string &path, size_t &size,
+                                     MappedFile::Advice advice) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return MAP_FAILED;
+    }
+
     struct stat sb;
     if (fstat(fd, &sb) == -1) {
         close(fd);
-        return false;
+        return MAP_FAILED;
     }
 
-    size_t file_size = sb.st_size;
-    if (file_size == 0) {
-        output.clear();
-        close(fd);
-        return true;
+    size = sb.st_size;
+    void* addr = map_fd(fd, size, advice);
+    // 映射建立后即可关闭 fd, 映射区域仍然有效
+    close(fd);
+    return addr;
+}
+
+
+void *AtomicFileOperator::map_fd(int fd, size_t size, MappedFile::Advice advice) {
+    if (size == 0) {
+        // 空文件不做映射, 以 nullptr 表示
+        return nullptr;
     }
 
-    void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
     if (addr == MAP_FAILED) {
-        close(fd);
-        return false;
+        return MAP_FAILED;
     }
 
-    output.assign(static_cast<const char*>(addr), file_size);
+    switch (advice) {
+        case MappedFile::Advice::SEQUENTIAL:
+            madvise(addr, size, MADV_SEQUENTIAL);
+            break;
+        case MappedFile::Advice::WILLNEED:
+            madvise(addr, size, MADV_WILLNEED);
+            break;
+        case MappedFile::Advice::NORMAL:
+            break;
+    }
+    return addr;
+}
 
-    munmap(addr, file_size);
-    close(fd);
+
+bool AtomicFileOperator::pread_fully(int fd, size_t size, std::string &output) {
+    output.resize(size);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, output.data() + done, size - done, static_cast<off_t>(done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            output.resize(done);
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
     return true;
 }
 
+bool AtomicFileOperator::write_fully(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool AtomicFileOperator::is_internal_name(const std::string &filename) {
+    return filename.compare(0, strlen(INTERNAL_PREFIX), INTERNAL_PREFIX) == 0;
+}
+
+string AtomicFileOperator::internal_path(const std::string &path, const std::string &tag, const char *suffix) {
+    const filesystem::path file_path(path);
+    return (file_path.parent_path() / (INTERNAL_PREFIX + tag + file_path.filename().string() + suffix)).string();
+}
+
+string AtomicFileOperator::temp_path_for(const std::string &path) {
+    return internal_path(path, to_string(getpid()) + "-", TEMP_SUFFIX);
+}
+
+bool AtomicFileOperator::recover_append(const std::string &path, const std::string &journal_path) {
+    int journal_fd = open(journal_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (journal_fd == -1) {
+        return errno == ENOENT;
+    }
+
+    AppendIntent intent{};
+    ssize_t n = read(journal_fd, &intent, sizeof(intent));
+    close(journal_fd);
 
-bool AtomicFileOperator::stream_read(const std::string &path, std::string &output) {
-    ifstream file(path, ios::binary | ios::ate);
-    if (!file) {
+    // 空日志: O_EXCL 创建后尚未写入意图, 追加尚未开始, 文件内容无需回滚
+    if (n == 0) {
+        unlink(journal_path.c_str());
+        return true;
+    }
+    // 不含 device/inode 的旧格式日志无法确认归属, 只删除日志
+    const auto legacy_size = static_cast<ssize_t>(offsetof(AppendIntent, device));
+    if ((n != sizeof(intent) && n != legacy_size) || intent.magic != APPEND_JOURNAL_MAGIC) {
         return false;
     }
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        if (errno != ENOENT) {
+            return false;
+        }
+    } else if (n == sizeof(intent) && static_cast<uint64_t>(st.st_dev) == intent.device &&
+               static_cast<uint64_t>(st.st_ino) == intent.inode &&
+               static_cast<uint64_t>(st.st_size) >= intent.original_size &&
+               truncate(path.c_str(), static_cast<off_t>(intent.original_size)) != 0) {
+        return false;
+    }
+    unlink(journal_path.c_str());
+    return true;
+}
 
-    size_t size = file.tellg();
-    file.seekg(0, ios::beg);
+void AtomicFileOperator::settle_append_journal(const std::string &path) {
+    const string journal_path = internal_path(path, "", APPEND_JOURNAL_SUFFIX);
+    // 目标即将被替换, 无法解析的日志同样作废
+    if (!recover_append(path, journal_path)) {
+        unlink(journal_path.c_str());
+    }
+}
 
-    output.resize(size);
-    file.read(output.data(), size);
-    return !file.fail();
+size_t AtomicFileOperator::cleanup_stale_files(const std::string &dir_path, chrono::seconds min_age) {
+    auto has_suffix = [](const string& name, const char* suffix) {
+        const size_t n = strlen(suffix);
+        return name.size() > n && name.compare(name.size() - n, n, suffix) == 0;
+    };
+
+    const time_t cutoff = time(nullptr) - static_cast<time_t>(min_age.count());
+    vector<string> candidates;
+    DirectoryScanner::scan(dir_path, [&](vector<DirectoryScanner::Entry>& chunk) {
+        for (auto& entry : chunk) {
+            if (entry.st.st_mtime >= cutoff || !is_internal_name(entry.name)) {
+                continue;
+            }
+            if (has_suffix(entry.name, TEMP_SUFFIX) || has_suffix(entry.name, STREAM_SUFFIX) ||
+                (has_suffix(entry.name, APPEND_JOURNAL_SUFFIX) &&
+                 static_cast<size_t>(entry.st.st_size) <= sizeof(AppendIntent))) {
+                candidates.push_back(std::move(entry.name));
+            }
+        }
+        return true;
+    });
+
+    size_t cleaned = 0;
+    const size_t prefix_size = strlen(INTERNAL_PREFIX);
+    for (const auto& name : candidates) {
+        const string stale_path = (filesystem::path(dir_path) / name).string();
+
+        if (has_suffix(name, APPEND_JOURNAL_SUFFIX)) {
+            const string target = name.substr(prefix_size, name.size() - prefix_size - strlen(APPEND_JOURNAL_SUFFIX));
+            const string path = (filesystem::path(dir_path) / target).string();
+            // 持有目标文件的写锁, 进行中的追加 (跨进程模式下包括其他进程) 完成后才会处理
+            auto lock = _lock_manager.get_lock(path);
+            if (!lock->lock()) {
+                continue;
+            }
+            unique_lock exclusive_lock(*lock, adopt_lock);
+            struct stat st;
+            if (stat(stale_path.c_str(), &st) == 0 && st.st_mtime < cutoff && recover_append(path, stale_path)) {
+                cleaned++;
+            }
+            continue;
+        }
+
+        // ".fm-<pid>-...": 所属进程仍在运行时写入可能尚未完成, 保留
+        const size_t dash = name.find('-', prefix_size);
+        const string pid = name.substr(prefix_size, dash == string::npos ? 0 : dash - prefix_size);
+        if (pid.empty() || pid.find_first_not_of("0123456789") != string::npos) {
+            continue;
+        }
+        const pid_t owner = static_cast<pid_t>(strtol(pid.c_str(), nullptr, 10));
+        if (owner != getpid()) {
+            if (kill(owner, 0) == 0 || errno != ESRCH) {
+                continue;
+            }
+            cleaned += unlink(stale_path.c_str()) == 0 ? 1 : 0;
+            continue;
+        }
+
+        // 本进程的 update 临时文件只在持有目标写锁期间存在, 拿到锁后仍存在即为残留 (pid 被复用);
+        // 本进程的写入流可能尚未提交, 保留
+        if (has_suffix(name, TEMP_SUFFIX)) {
+            const string target = name.substr(dash + 1, name.size() - dash - 1 - strlen(TEMP_SUFFIX));
+            auto lock = _lock_manager.get_lock((filesystem::path(dir_path) / target).string());
+            if (!lock->lock()) {
+                continue;
+            }
+            unique_lock exclusive_lock(*lock, adopt_lock);
+            cleaned += unlink(stale_path.c_str()) == 0 ? 1 : 0;
+        }
+    }
+    return cleaned;
 }
 
-bool AtomicFileOperator::append_file(const std::string &path, const std::string &content) {
-    ofstream file(path, ios::app | ios::binary);
-    if (!file) {
+bool AtomicFileOperator::sync_directory(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
         return false;
     }
+    bool success = fsync(fd) == 0;
+    close(fd);
+    return success;
+}
+
 
-    file.write(content.data(), content.size());
-    return file.good();
+DurableWriteBatch::DurableWriteBatch(AtomicFileOperator &file_operator)
+        : _file_operator(file_operator) {}
+
+DurableWriteBatch::~DurableWriteBatch() {
+    release();
 }
 
-bool AtomicFileOperator::copy_file(const std::string &src, const std::string &dest) {
-    ifstream in(src, ios::binary);
-    if (!in) {
-        return false;
+void DurableWriteBatch::add(WriteType type, const std::string &path, const std::string &content,
+                            Durability durability) {
+    Entry entry{type, path, "", "", durability, nullptr, false};
+
+    if (AtomicFileOperator::is_internal_name(filesystem::path(path).filename().string())) {
+        _entries.push_back(std::move(entry));
+        return;
     }
 
-    ofstream out(dest, ios::binary | ios::trunc);
-    if (!out) {
-        return false;
+    for (const auto& existing : _entries) {
+        if (existing.path == path) {
+            // 同一路径重复加锁会死锁, 调用方应先合并同一路径的写入
+            _entries.push_back(std::move(entry));
+            return;
+        }
+    }
+
+    auto lock = _file_operator._lock_manager.get_lock(path);
+    if (!lock->lock()) {
+        _entries.push_back(std::move(entry));
+        return;
+    }
+    entry.lock = std::move(lock);
+    if (type != WriteType::APPEND) {
+        AtomicFileOperator::settle_append_journal(path);
+    }
+
+    switch (type) {
+        case WriteType::CREATE:
+            _file_operator.ensure_parent_directory(path);
+            entry.content = content;
+            entry.success = true;
+            break;
+        case WriteType::UPDATE:
+            // 提交失败时保留 temp_path, 由 release 清理残留的临时文件
+            entry.temp_path = AtomicFileOperator::temp_path_for(path);
+            _file_operator.ensure_parent_directory(entry.temp_path);
+            entry.content = content;
+            entry.success = true;
+            break;
+        case WriteType::APPEND:
+            entry.success = _file_operator.append_locked(path, content);
+            break;
+        case WriteType::DELETE: {
+            error_code ec;
+            entry.success = filesystem::remove(path, ec);
+            break;
+        }
+    }
+    _entries.push_back(std::move(entry));
+}
+
+vector<bool> DurableWriteBatch::commit() {
+    // 新内容的写入, 落盘与 rename 整批提交; 追加的内容已写入, 只需落盘
+    vector<IoBackend::FileOp> ops;
+    vector<Entry*> owners;
+    for (auto& entry : _entries) {
+        if (!entry.success) {
+            continue;
+        }
+        const bool sync = entry.durability != Durability::NONE;
+        switch (entry.type) {
+            case WriteType::CREATE:
+                ops.push_back({entry.path, &entry.content, sync, "", false});
+                break;
+            case WriteType::UPDATE:
+                ops.push_back({entry.temp_path, &entry.content, sync, entry.path, false});
+                break;
+            case WriteType::APPEND:
+                if (!sync) {
+                    continue;
+                }
+                ops.push_back({entry.path, nullptr, true, "", false});
+                break;
+            case WriteType::DELETE:
+                continue;
+        }
+        owners.push_back(&entry);
+    }
+    if (!ops.empty()) {
+        _file_operator.io_backend()->execute(ops);
+    }
+
+    for (size_t i = 0; i < owners.size(); ++i) {
+        owners[i]->success = ops[i].success;
+        if (owners[i]->type == WriteType::UPDATE && ops[i].success) {
+            owners[i]->temp_path.clear();
+        }
+    }
+
+    set<string> directories;
+    for (const auto& entry : _entries) {
+        if (entry.success && entry.durability == Durability::DURABLE) {
+            directories.insert(filesystem::path(entry.path).parent_path().string());
+        }
     }
 
-    out << in.rdbuf();
+    // 目录项 (新建, rename, 删除) 只有父目录 fsync 后才能在掉电后保留
+    for (const auto& directory : directories) {
+        if (AtomicFileOperator::sync_directory(directory)) {
+            continue;
+        }
+        for (auto& entry : _entries) {
+            if (entry.durability == Durability::DURABLE &&
+                filesystem::path(entry.path).parent_path() == directory) {
+                entry.success = false;
+            }
+        }
+    }
 
-    return in.good() && out.good();
-}
\ No newline at end of file
+    vector<bool> results;
+    results.reserve(_entries.size());
+    for (const auto& entry : _entries) {
+        results.push_back(entry.success);
+    }
+    release();
+    return results;
+}
+
+void DurableWriteBatch::release() {
+    for (auto& entry : _entries) {
+        if (!entry.temp_path.empty()) {
+            error_code ec;
+            filesystem::remove(entry.temp_path, ec);
+        }
+        if (entry.lock) {
+            entry.lock->unlock();
+        }
+    }
+    _entries.clear();
+}
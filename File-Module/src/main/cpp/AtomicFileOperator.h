@@ -6,16 +6,145 @@
 #define ANDROIDX_JETPACK_ATOMICFILEOPERATOR_H
 
 #include "FileLockManager.h"
-#include <fstream>
+#include "FileWriteTypes.h"
+#include "IoBackend.h"
 #include <system_error>
+#include <cerrno>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <filesystem>
+#include <memory>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <functional>
+#include <mutex>
 
 using namespace std;
 
+/**
+ * 文件映射视图
+ * 持有文件的 mmap 区域与路径共享锁, 视图存活期间文件不会被改写; 最后一个引用释放时解除映射并释放锁
+ */
+class MappedFile {
+
+public:
+    enum class Advice {
+        NORMAL,
+        SEQUENTIAL,
+        WILLNEED
+    };
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {
+        return static_cast<const char*>(_addr);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+private:
+    friend class AtomicFileOperator;
+
+    MappedFile(FileLockManager::LockPtr lock, void* addr, size_t size);
+
+    FileLockManager::LockPtr _lock;
+    void* _addr;
+    size_t _size;
+};
+
+/**
+ * 分块读取流
+ * 与 MappedFile 相同, 存活期间持有路径共享锁, 读到的始终是打开时的完整内容; 内存占用只取决于调用方每次读取的块大小
+ */
+class FileReadStream {
+
+public:
+    ~FileReadStream();
+
+    FileReadStream(const FileReadStream&) = delete;
+
+    FileReadStream& operator=(const FileReadStream&) = delete;
+
+    // 读取最多 size 字节, 返回实际读取的字节数; 到达末尾返回 0, 出错返回 -1
+    ssize_t read(char* buffer, size_t size);
+
+    uint64_t size() const {
+        return _size;
+    }
+
+    uint64_t position() const {
+        return _position;
+    }
+
+private:
+    friend class AtomicFileOperator;
+
+    FileReadStream(FileLockManager::LockPtr lock, int fd, uint64_t size);
+
+    FileLockManager::LockPtr _lock;
+    int _fd;
+    uint64_t _size;
+    uint64_t _position = 0;
+};
+
+/**
+ * 分块写入流
+ * 内容写入同目录下的独立临时文件, 写入期间不持锁, 不阻塞其他读写; commit 时持写锁 rename 替换目标文件
+ * 未提交即析构时丢弃临时文件, 目标文件保持不变
+ */
+class FileWriteStream {
+
+public:
+    // 提交完成后回调, 在调用 commit 的线程上执行
+    using CommitCallback = function<void(const string& path, bool success)>;
+
+    ~FileWriteStream();
+
+    FileWriteStream(const FileWriteStream&) = delete;
+
+    FileWriteStream& operator=(const FileWriteStream&) = delete;
+
+    bool write(const char* data, size_t size);
+
+    // 只能调用一次; 此前任何一次写入失败时放弃提交并返回 false
+    bool commit(Durability durability = Durability::NONE);
+
+    void set_commit_callback(CommitCallback on_commit);
+
+    uint64_t size() const {
+        return _size;
+    }
+
+private:
+    friend class AtomicFileOperator;
+
+    FileWriteStream(FileLockManager& lock_manager, string path, string temp_path, int fd);
+
+    void discard();
+
+    FileLockManager& _lock_manager;
+    string _path;
+    string _temp_path;
+    int _fd;
+    uint64_t _size = 0;
+    bool _failed = false;
+    CommitCallback _on_commit;
+};
+
 /**
  * 原子文件操作
  */
@@ -24,33 +153,150 @@ class AtomicFileOperator {
 public:
     explicit AtomicFileOperator(FileLockManager& lock_manager);
 
-    bool create_file(const string& path, const string& content);
+    bool create_file(const string& path, const string& content,
+                     Durability durability = Durability::NONE);
 
     bool read_file(const string& path, string& output);
 
-    bool update_file(const string& path, const string& content);
+    using MappedView = shared_ptr<const MappedFile>;
+
+    // 零拷贝读取: 返回引用计数的映射视图, 失败返回 nullptr
+    MappedView map_file(const string& path,
+                        MappedFile::Advice advice = MappedFile::Advice::SEQUENTIAL);
+
+    bool update_file(const string& path, const string& content,
+                     Durability durability = Durability::NONE);
+
+    // 追加写: O_APPEND 只写入新增字节, 通过意图日志保证崩溃后可回滚到追加前的长度
+    bool append_file_safely(const string& path, const string& content,
+                            Durability durability = Durability::NONE);
+
+    bool delete_file(const string& path, Durability durability = Durability::NONE);
 
-    bool append_file_safely(const string& path, const string& content);
+    using ReadStream = unique_ptr<FileReadStream>;
+    using WriteStream = unique_ptr<FileWriteStream>;
 
-    bool delete_file(const string& path);
+    // 文件不存在或无法打开时返回 nullptr
+    ReadStream open_read_stream(const string& path);
+
+    WriteStream open_write_stream(const string& path);
 
     bool file_exists(const string& path);
 
+    // DurableWriteBatch 提交时使用的 I/O 后端, 默认为同步实现; 可在运行中切换, 进行中的提交不受影响
+    void set_io_backend(shared_ptr<IoBackend> backend);
+
+    shared_ptr<IoBackend> io_backend() const;
+
+    // 清理崩溃残留: 删除早于 min_age 且所属进程已退出的临时文件, 回滚残留的追加意图日志; 返回处理的文件数
+    // 只处理以 INTERNAL_PREFIX 开头的文件, 业务文件不能使用该前缀, 不会被误删
+    size_t cleanup_stale_files(const string& dir_path, chrono::seconds min_age);
+
+    // 内部文件名前缀, 以此开头的文件名保留给模块自身, 写入时拒绝
+    static constexpr const char* INTERNAL_PREFIX = ".fm-";
+    // update 临时文件 ".fm-<pid>-<目标文件名>.tmp"
+    static constexpr const char* TEMP_SUFFIX = ".tmp";
+    // 追加意图日志 ".fm-<目标文件名>.append", 不含 pid, 下次追加或清理时才能找到
+    static constexpr const char* APPEND_JOURNAL_SUFFIX = ".append";
+    // 写入流临时文件 ".fm-<pid>-<序号>-<目标文件名>.stream"
+    static constexpr const char* STREAM_SUFFIX = ".stream";
+
+    static bool is_internal_name(const string& filename);
 
 private:
+    friend class DurableWriteBatch;
+    friend class FileWriteStream;
+
     static constexpr size_t MMAP_THRESHOLD = 1024 * 1024;
+    static constexpr uint32_t APPEND_JOURNAL_MAGIC = 0x41504E44; // "APND"
+
+    // device/inode 标识日志所属的文件, 目标被替换后不会误截断新文件
+    struct AppendIntent {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t original_size;
+        uint64_t device;
+        uint64_t inode;
+    };
 
     void ensure_parent_directory(const string& path);
 
-    bool mmap_read(const string& path, string& output);
+    bool write_file_locked(const string& path, const string& content);
+
+    bool append_locked(const string& path, const string& content);
+
+    bool commit_single(WriteType type, const string& path, const string& content,
+                       Durability durability);
+
+    static bool mmap_read(int fd, size_t size, string& output);
 
-    bool stream_read(const string& path, string& output);
+    static void* map_region(const string& path, size_t& size, MappedFile::Advice advice);
 
-    bool append_file(const string& path, const string& content);
+    // 空文件返回 nullptr, 失败返回 MAP_FAILED
+    static void* map_fd(int fd, size_t size, MappedFile::Advice advice);
 
-    bool copy_file(const string& src, const string& dest);
+    // 按 fstat 得到的大小读取; 期间文件被截短时只返回实际读到的内容
+    static bool pread_fully(int fd, size_t size, string& output);
+
+    static bool write_fully(int fd, const char* data, size_t size);
+
+    // 同目录下的内部文件路径: "<目录>/.fm-<tag><目标文件名><suffix>"
+    static string internal_path(const string& path, const string& tag, const char* suffix);
+
+    static string temp_path_for(const string& path);
+
+    // 日志为空 (创建后未写入即崩溃) 或魔数校验通过时处理并删除日志, 返回 true; 只有目标仍是记录的
+    // 文件 (inode 相同) 且长度不小于追加前的长度时才截断回滚, 否则只删除日志
+    // 校验失败时不删除日志也不截断文件, 返回 false
+    static bool recover_append(const string& path, const string& journal_path);
+
+    // 持写锁替换或删除目标文件前调用: 回滚残留的追加后删除日志, 之后的追加不会按旧日志截断新内容
+    static void settle_append_journal(const string& path);
+
+    static bool sync_directory(const string& path);
 
     FileLockManager& _lock_manager;
+    shared_ptr<IoBackend> _io_backend;
+    mutable mutex _backend_mutex;
+};
+
+/**
+ * 批量落盘提交
+ * add 阶段加锁并记录内容, 追加与删除立即执行; commit 时整批的写入, 落盘与 rename 交给 I/O 后端,
+ * 同步实现共用一次 syncfs, io_uring 实现在一次提交中完成; 最后 DURABLE 写入涉及的每个父目录只 fsync 一次
+ * 提交完成前持有各路径的写锁, 同一路径在一个批次内只能出现一次
+ */
+class DurableWriteBatch {
+
+public:
+    explicit DurableWriteBatch(AtomicFileOperator& file_operator);
+
+    ~DurableWriteBatch();
+
+    DurableWriteBatch(const DurableWriteBatch&) = delete;
+
+    DurableWriteBatch& operator=(const DurableWriteBatch&) = delete;
+
+    void add(WriteType type, const string& path, const string& content, Durability durability);
+
+    // 按 add 的顺序返回每个写入的结果, 数据未能落盘的写入视为失败
+    vector<bool> commit();
+
+private:
+    struct Entry {
+        WriteType type;
+        string path;
+        string temp_path;
+        string content;         // create/update 延后到 commit 写入
+        Durability durability;
+        FileLockManager::LockPtr lock;
+        bool success;
+    };
+
+    void release();
+
+    AtomicFileOperator& _file_operator;
+    vector<Entry> _entries;
 };
 
 
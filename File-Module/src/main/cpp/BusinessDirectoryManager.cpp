@@ -9,6 +9,17 @@ BusinessDirectoryManager::BusinessDirectoryManager(const string &base_path): _ba
     create_directory(_base_path);
 }
 
+void BusinessDirectoryManager::set_directory_listener(DirectoryListener listener) {
+    unique_lock lock(m_mutex);
+    _listener = std::move(listener);
+    if (_listener) {
+        for (const auto& [business_id, path] : _business_paths) {
+            _listener(path);
+        }
+    }
+}
+
+
 string BusinessDirectoryManager::resolve_path(const std::string &business_id,
                                               const std::string &filename) {
     string business_path = get_business_path(business_id);
@@ -16,6 +27,17 @@ string BusinessDirectoryManager::resolve_path(const std::string &business_id,
 }
 
 
+vector<string> BusinessDirectoryManager::business_paths() {
+    shared_lock lock(m_mutex);
+    vector<string> paths;
+    paths.reserve(_business_paths.size());
+    for (const auto& [business_id, path] : _business_paths) {
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+
 void BusinessDirectoryManager::create_directory(const std::string &path) {
     error_code ec;
     if (!filesystem::exists(path, ec) && !ec) {
@@ -39,6 +61,9 @@ string BusinessDirectoryManager::get_business_path(const std::string &business_i
         string path = (filesystem::path(_base_path) / business_id).string();
         create_directory(path);
         it->second = std::move(path);
+        if (_listener) {
+            _listener(it->second);
+        }
     }
     return it->second;
 }
\ No newline at end of file
@@ -7,9 +7,12 @@
 
 #include <string>
 #include <filesystem>
+#include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 #include <system_error>
+#include <functional>
+#include <vector>
 
 using namespace std;
 
@@ -19,19 +22,29 @@ using namespace std;
 class BusinessDirectoryManager {
 
 public:
+    using DirectoryListener = function<void(const string& dir_path)>;
+
     explicit BusinessDirectoryManager(const string& base_path);
 
+    // 每个业务目录首次解析时回调一次; 设置时对已有目录立即补发
+    void set_directory_listener(DirectoryListener listener);
+
     string resolve_path(const string& business_id,
                         const string& filename);
 
+    // 本进程已解析过的业务目录
+    vector<string> business_paths();
+
+    // 业务目录路径, 首次解析时创建目录
+    string get_business_path(const string& business_id);
+
 private:
 
     void create_directory(const string& path);
 
-    string get_business_path(const string& business_id);
-
     string _base_path;
     unordered_map<string, string> _business_paths;
+    DirectoryListener _listener;
     shared_mutex m_mutex;
 };
 
@@ -0,0 +1,179 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_CLOCKLRUCACHE_H
+#define ANDROIDX_JETPACK_CLOCKLRUCACHE_H
+
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <optional>
+#include <memory>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 近似 LRU (CLOCK) 缓存
+ * 命中只持有共享锁并置位访问标记, 淘汰时由时钟指针扫描决定
+ */
+template <typename Key, typename Value>
+class ClockLRUCache {
+
+public:
+    explicit ClockLRUCache(size_t capacity)
+            : _capacity(capacity > 0 ? capacity : 1),
+              _slots(make_unique<Slot[]>(_capacity)),
+              _hand(0),
+              _size(0) {
+        _free_slots.reserve(_capacity);
+        for (size_t i = _capacity; i > 0; --i) {
+            _free_slots.push_back(i - 1);
+        }
+    }
+
+    bool put(const Key& key, Value&& value) {
+        unique_lock lock(m_mutex);
+        auto it = _index.find(key);
+        if (it != _index.end()) {
+            Slot& slot = _slots[it->second];
+            slot.value = std::move(value);
+            slot.referenced.store(true, memory_order_relaxed);
+            return true;
+        }
+
+        size_t slot_index = _free_slots.empty() ? evict_locked() : take_free_slot();
+        Slot& slot = _slots[slot_index];
+        slot.key = key;
+        slot.value = std::move(value);
+        slot.occupied = true;
+        slot.referenced.store(false, memory_order_relaxed);
+        _index.emplace(key, slot_index);
+        _size++;
+        return true;
+    }
+
+    bool put(const Key& key, const Value& value) {
+        Value temp = value;
+        return put(key, std::move(temp));
+    }
+
+    optional<Value> get(const Key& key) {
+        shared_lock lock(m_mutex);
+        auto it = _index.find(key);
+        if (it == _index.end()) {
+            return nullopt;
+        }
+
+        // 命中路径不获取独占锁, 只记录访问标记
+        const Slot& slot = _slots[it->second];
+        slot.referenced.store(true, memory_order_relaxed);
+        return slot.value;
+    }
+
+    bool remove(const Key& key) {
+        unique_lock lock(m_mutex);
+        auto it = _index.find(key);
+        if (it == _index.end()) {
+            return false;
+        }
+
+        release_slot_locked(it->second);
+        _index.erase(it);
+        return true;
+    }
+
+    bool contains(const Key& key) const {
+        shared_lock lock(m_mutex);
+        return _index.find(key) != _index.end();
+    }
+
+    size_t size() const {
+        shared_lock lock(m_mutex);
+        return _size;
+    }
+
+    void clear() {
+        unique_lock lock(m_mutex);
+        for (auto& [_, slot_index] : _index) {
+            release_slot_locked(slot_index);
+        }
+        _index.clear();
+        _hand = 0;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    // 按时钟顺序淘汰到不超过 target 个条目, 返回淘汰数量
+    size_t trim(size_t target) {
+        unique_lock lock(m_mutex);
+        size_t removed = 0;
+        while (_size > target) {
+            _free_slots.push_back(evict_locked());
+            removed++;
+        }
+        return removed;
+    }
+
+private:
+    struct Slot {
+        Key key{};
+        Value value{};
+        mutable atomic<bool> referenced{false};
+        bool occupied = false;
+    };
+
+    size_t take_free_slot() {
+        size_t slot_index = _free_slots.back();
+        _free_slots.pop_back();
+        return slot_index;
+    }
+
+    // 时钟扫描: 跳过并清除最近访问过的槽位, 淘汰第一个未访问的槽位
+    size_t evict_locked() {
+        while (true) {
+            Slot& slot = _slots[_hand];
+            size_t current = _hand;
+            _hand = (_hand + 1) % _capacity;
+
+            if (!slot.occupied) {
+                continue;
+            }
+            if (slot.referenced.exchange(false, memory_order_relaxed)) {
+                continue;
+            }
+
+            _index.erase(slot.key);
+            slot.occupied = false;
+            slot.key = Key{};
+            slot.value = Value{};
+            _size--;
+            return current;
+        }
+    }
+
+    void release_slot_locked(size_t slot_index) {
+        Slot& slot = _slots[slot_index];
+        slot.occupied = false;
+        slot.referenced.store(false, memory_order_relaxed);
+        slot.key = Key{};
+        slot.value = Value{};
+        _free_slots.push_back(slot_index);
+        _size--;
+    }
+
+    size_t _capacity;
+    unique_ptr<Slot[]> _slots;
+    vector<size_t> _free_slots;
+    unordered_map<Key, size_t> _index;
+    mutable shared_mutex m_mutex;
+    size_t _hand;
+    size_t _size;
+};
+
+
+#endif //ANDROIDX_JETPACK_CLOCKLRUCACHE_H
@@ -77,6 +77,20 @@ public:
         return _capacity;
     }
 
+    // 从链表尾部淘汰到不超过 target 个条目, 返回淘汰数量
+    size_t trim(size_t target) {
+        unique_lock lock(m_mutex);
+        size_t removed = 0;
+        while (_size > target) {
+            auto last = --_list.end();
+            _map.erase(last->first);
+            _list.pop_back();
+            _size--;
+            removed++;
+        }
+        return removed;
+    }
+
 private:
     using ListType = list<pair<Key, Value>>;
     using ListIterator = typename ListType::iterator;
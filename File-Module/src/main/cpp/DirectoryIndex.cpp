@@ -0,0 +1,166 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "DirectoryIndex.h"
+#include "DirectoryScanner.h"
+#include "AtomicFileOperator.h"
+
+
+DirectoryIndex::Filter::Filter(string sub_str, int32_t day, bool flag)
+        : sub_str(std::move(sub_str)), day(day), flag(flag) {
+    if (day > 0) {
+        cutoff_time = FileMetadataManager::current_file_time() - chrono::hours(24 * day);
+    }
+}
+
+
+bool DirectoryIndex::Filter::accepts(const std::string &name, FileTime mtime) const {
+    if (!sub_str.empty() && name.find(sub_str) == string::npos) {
+        return false;
+    }
+    if (day > 0) {
+        return flag ? mtime >= cutoff_time : mtime < cutoff_time;
+    }
+    return true;
+}
+
+
+DirectoryIndex::DirectoryIndex(string dir_path) : _dir_path(std::move(dir_path)) {}
+
+
+bool DirectoryIndex::ensure_built(FileMetadataManager &metadata_manager, const ChunkCallback &on_chunk) {
+    {
+        shared_lock lock(_mutex);
+        if (_built) {
+            return true;
+        }
+    }
+
+    unique_lock lock(_mutex);
+    _build_cv.wait(lock, [this] {
+        return !_building;
+    });
+    if (_built) {
+        return true;
+    }
+    _building = true;
+    _pending.clear();
+    lock.unlock();
+
+    // 扫描不持锁: 回调可能耗时较长 (例如经 JNI 回到 Java), 不应阻塞写入线程的增量更新
+    vector<pair<string, FileTime>> scanned;
+    bool completed = DirectoryScanner::scan(_dir_path, [&](vector<DirectoryScanner::Entry>& chunk) {
+        vector<FileMetadataManager::DirectoryEntry> entries;
+        entries.reserve(chunk.size());
+        for (auto& item : chunk) {
+            if (AtomicFileOperator::is_internal_name(item.name)) {
+                continue;
+            }
+            auto& entry = entries.emplace_back();
+            entry.name = std::move(item.name);
+            entry.metadata.assign(item.st);
+            scanned.emplace_back(entry.name, entry.metadata.last_modified);
+        }
+        // 同时批量刷新元数据缓存
+        metadata_manager.store_entries(_dir_path, entries.data(), entries.size());
+        return !on_chunk || on_chunk(entries);
+    });
+
+    lock.lock();
+    if (completed) {
+        _by_name.clear();
+        _by_mtime.clear();
+        for (auto& [name, mtime] : scanned) {
+            upsert_locked(name, mtime);
+        }
+        // 扫描期间完成的写入晚于或等同于扫描到的状态, 按顺序重放即可
+        for (auto& change : _pending) {
+            if (change.mtime.has_value()) {
+                upsert_locked(change.name, *change.mtime);
+            } else {
+                remove_locked(change.name);
+            }
+        }
+        _built = true;
+    }
+    _building = false;
+    _pending.clear();
+    lock.unlock();
+    _build_cv.notify_all();
+    return completed;
+}
+
+
+void DirectoryIndex::upsert(const std::string &name, FileTime mtime) {
+    if (AtomicFileOperator::is_internal_name(name)) {
+        return;
+    }
+    unique_lock lock(_mutex);
+    if (_built) {
+        upsert_locked(name, mtime);
+    } else if (_building) {
+        _pending.push_back(Change{name, mtime});
+    }
+}
+
+
+void DirectoryIndex::remove(const std::string &name) {
+    unique_lock lock(_mutex);
+    if (_built) {
+        remove_locked(name);
+    } else if (_building) {
+        _pending.push_back(Change{name, nullopt});
+    }
+}
+
+
+void DirectoryIndex::query(const Filter &filter, vector<std::string> &files) const {
+    shared_lock lock(_mutex);
+    if (filter.day <= 0) {
+        for (const auto& [name, item] : _by_name) {
+            if (filter.accepts(name, item.mtime)) {
+                files.push_back(name);
+            }
+        }
+        return;
+    }
+
+    // 只遍历年龄窗口一侧的文件
+    auto boundary = _by_mtime.lower_bound(filter.cutoff_time);
+    auto first = filter.flag ? boundary : _by_mtime.begin();
+    auto last = filter.flag ? _by_mtime.end() : boundary;
+    for (auto it = first; it != last; ++it) {
+        if (filter.accepts(*it->second, it->first)) {
+            files.push_back(*it->second);
+        }
+    }
+}
+
+
+size_t DirectoryIndex::size() const {
+    shared_lock lock(_mutex);
+    return _by_name.size();
+}
+
+
+void DirectoryIndex::upsert_locked(const std::string &name, FileTime mtime) {
+    auto [it, inserted] = _by_name.try_emplace(name);
+    if (!inserted) {
+        if (it->second.mtime == mtime) {
+            return;
+        }
+        _by_mtime.erase(it->second.by_mtime);
+    }
+    it->second.mtime = mtime;
+    it->second.by_mtime = _by_mtime.emplace(mtime, &it->first);
+}
+
+
+void DirectoryIndex::remove_locked(const std::string &name) {
+    auto it = _by_name.find(name);
+    if (it != _by_name.end()) {
+        _by_mtime.erase(it->second.by_mtime);
+        _by_name.erase(it);
+    }
+}
@@ -0,0 +1,90 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_DIRECTORYINDEX_H
+#define ANDROIDX_JETPACK_DIRECTORYINDEX_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <shared_mutex>
+#include <condition_variable>
+#include <functional>
+#include <optional>
+#include <filesystem>
+#include <cstdint>
+#include "FileMetadataManager.h"
+
+using namespace std;
+
+/**
+ * 单个业务目录的内存索引
+ * 按文件名有序保存, 另有按 mtime 排序的索引; 年龄窗口查询只遍历窗口内的文件, 查询过程不访问文件系统
+ * 首次查询时并行扫描目录建立, 扫描结果可按块流式交给调用方; 之后由调用方在写入完成或收到目录变更通知时增量维护
+ * 以 AtomicFileOperator::INTERNAL_PREFIX 开头的内部文件 (临时文件, 意图日志) 不进入索引, 也不交给调用方
+ */
+class DirectoryIndex {
+
+public:
+    using FileTime = filesystem::file_time_type;
+
+    // day > 0 时按 flag 选择最近 day 天内 (true) 或更早 (false) 修改的文件
+    struct Filter {
+        string sub_str;
+        int32_t day;
+        bool flag;
+        FileTime cutoff_time;
+
+        Filter(string sub_str, int32_t day, bool flag);
+
+        bool accepts(const string& name, FileTime mtime) const;
+    };
+
+    // 扫描中每完成一块回调一次, 返回 false 中止建立
+    using ChunkCallback = function<bool(const vector<FileMetadataManager::DirectoryEntry>& chunk)>;
+
+    explicit DirectoryIndex(string dir_path);
+
+    // 尚未建立时扫描目录, 扫描期间不持锁, 并发的增量更新暂存并在扫描结束后重放
+    // 其他线程正在建立时等待其完成; 只有实际执行扫描的调用会收到 on_chunk
+    bool ensure_built(FileMetadataManager& metadata_manager, const ChunkCallback& on_chunk = nullptr);
+
+    // 索引未建立且不在扫描中时直接忽略, 之后的扫描会读到最新状态
+    void upsert(const string& name, FileTime mtime);
+
+    void remove(const string& name);
+
+    void query(const Filter& filter, vector<string>& files) const;
+
+    size_t size() const;
+
+private:
+    using MtimeIndex = multimap<FileTime, const string*>;
+
+    struct Item {
+        FileTime mtime;
+        MtimeIndex::iterator by_mtime;
+    };
+
+    struct Change {
+        string name;
+        optional<FileTime> mtime;   // 为空表示删除
+    };
+
+    void upsert_locked(const string& name, FileTime mtime);
+
+    void remove_locked(const string& name);
+
+    string _dir_path;
+    map<string, Item> _by_name;
+    MtimeIndex _by_mtime;       // 值指向 _by_name 的 key, map 节点地址稳定
+    bool _built = false;
+    bool _building = false;
+    vector<Change> _pending;    // 扫描期间收到的增量更新
+    condition_variable_any _build_cv;
+    mutable shared_mutex _mutex;
+};
+
+
+#endif //ANDROIDX_JETPACK_DIRECTORYINDEX_H
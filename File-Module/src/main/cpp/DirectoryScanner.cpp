@@ -0,0 +1,205 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "DirectoryScanner.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace {
+
+constexpr size_t GETDENTS_BUFFER_SIZE = 64 * 1024;
+
+// getdents64 返回的原始记录布局
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+struct ScanState {
+    int dir_fd = -1;
+    mutex m_mutex;
+    condition_variable task_cv;
+    condition_variable result_cv;
+    deque<vector<string>> tasks;
+    deque<vector<DirectoryScanner::Entry>> results;
+    size_t outstanding = 0;     // 已提交但结果尚未放入 results 的块数
+    bool closing = false;
+};
+
+void stat_names(int dir_fd, vector<string>& names, vector<DirectoryScanner::Entry>& entries) {
+    entries.reserve(names.size());
+    for (auto& name : names) {
+        DirectoryScanner::Entry entry;
+        if (fstatat(dir_fd, name.c_str(), &entry.st, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !S_ISREG(entry.st.st_mode)) {
+            continue;
+        }
+        entry.name = std::move(name);
+        entries.push_back(std::move(entry));
+    }
+}
+
+void worker_loop(ScanState& state) {
+    while (true) {
+        unique_lock lock(state.m_mutex);
+        state.task_cv.wait(lock, [&state] {
+            return state.closing || !state.tasks.empty();
+        });
+        if (state.tasks.empty()) {
+            return;
+        }
+        vector<string> names = std::move(state.tasks.front());
+        state.tasks.pop_front();
+        lock.unlock();
+
+        vector<DirectoryScanner::Entry> entries;
+        stat_names(state.dir_fd, names, entries);
+
+        lock.lock();
+        state.results.push_back(std::move(entries));
+        state.outstanding--;
+        lock.unlock();
+        state.result_cv.notify_one();
+    }
+}
+
+}
+
+
+bool DirectoryScanner::scan(const std::string &dir_path,
+                            const ChunkCallback &on_chunk,
+                            size_t chunk_size,
+                            size_t max_threads) {
+    int dir_fd = open(dir_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        return false;
+    }
+    chunk_size = max(chunk_size, static_cast<size_t>(1));
+
+    ScanState state;
+    state.dir_fd = dir_fd;
+    vector<thread> workers;
+
+    // 交付已完成的块; wait_all 时等待所有已提交的块完成
+    auto deliver = [&](bool wait_all) {
+        while (true) {
+            unique_lock lock(state.m_mutex);
+            if (wait_all) {
+                state.result_cv.wait(lock, [&state] {
+                    return !state.results.empty() || state.outstanding == 0;
+                });
+            }
+            if (state.results.empty()) {
+                return true;
+            }
+            vector<Entry> chunk = std::move(state.results.front());
+            state.results.pop_front();
+            lock.unlock();
+
+            if (!chunk.empty() && !on_chunk(chunk)) {
+                return false;
+            }
+        }
+    };
+
+    // 线程按需创建, 每提交一块最多新增一个, 小目录不会创建线程
+    auto submit = [&](vector<string>&& names) {
+        if (max_threads == 0) {
+            vector<Entry> entries;
+            stat_names(dir_fd, names, entries);
+            lock_guard lock(state.m_mutex);
+            state.results.push_back(std::move(entries));
+            return;
+        }
+        if (workers.size() < max_threads) {
+            workers.emplace_back(worker_loop, std::ref(state));
+        }
+        {
+            lock_guard lock(state.m_mutex);
+            state.tasks.push_back(std::move(names));
+            state.outstanding++;
+        }
+        state.task_cv.notify_one();
+    };
+
+    vector<char> buffer(GETDENTS_BUFFER_SIZE);
+    vector<string> names;
+    names.reserve(chunk_size);
+    bool ok = true;
+    bool read_error = false;
+
+    while (ok) {
+        long n = syscall(SYS_getdents64, dir_fd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            read_error = n < 0;
+            break;
+        }
+
+        for (long offset = 0; offset < n;) {
+            auto* ent = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+            offset += ent->d_reclen;
+
+            // d_type 已知不是普通文件时无需 stat
+            if (ent->d_type != DT_REG && ent->d_type != DT_UNKNOWN) {
+                continue;
+            }
+            const char* name = buffer.data() + (offset - ent->d_reclen) + offsetof(LinuxDirent64, d_name);
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+                continue;
+            }
+
+            names.emplace_back(name);
+            if (names.size() == chunk_size) {
+                submit(std::move(names));
+                names = vector<string>();
+                names.reserve(chunk_size);
+            }
+        }
+        ok = deliver(false);
+    }
+
+    if (ok && !read_error && !names.empty()) {
+        // 没有创建过线程时直接在调用线程上完成, 避免为小目录付出线程开销
+        if (workers.empty()) {
+            vector<Entry> entries;
+            stat_names(dir_fd, names, entries);
+            ok = entries.empty() || on_chunk(entries);
+        } else {
+            submit(std::move(names));
+        }
+    }
+    if (ok && !read_error) {
+        ok = deliver(true);
+    }
+
+    {
+        lock_guard lock(state.m_mutex);
+        if (!ok || read_error) {
+            state.tasks.clear();
+        }
+        state.closing = true;
+    }
+    state.task_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    close(dir_fd);
+    return ok && !read_error;
+}
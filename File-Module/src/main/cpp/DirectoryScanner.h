@@ -0,0 +1,43 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_DIRECTORYSCANNER_H
+#define ANDROIDX_JETPACK_DIRECTORYSCANNER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+ * 大目录扫描
+ * 调用线程以大缓冲区读取 getdents64, 文件名按块分发给内部线程并行 fstatat, 完成的块流式交回调用线程
+ * 目录项不足一块时不创建线程, 直接在调用线程上 stat
+ */
+class DirectoryScanner {
+
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 512;
+    static constexpr size_t MAX_THREADS = 4;
+
+    struct Entry {
+        string name;
+        struct stat st;
+    };
+
+    // 只包含普通文件; 块的顺序与目录顺序无关, 返回 false 时立即结束扫描
+    using ChunkCallback = function<bool(vector<Entry>& chunk)>;
+
+    // 回调总在调用线程上执行, 可以安全地使用 JNIEnv 等线程相关的资源
+    // 目录无法打开或被回调中止时返回 false
+    static bool scan(const string& dir_path,
+                     const ChunkCallback& on_chunk,
+                     size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                     size_t max_threads = MAX_THREADS);
+};
+
+
+#endif //ANDROIDX_JETPACK_DIRECTORYSCANNER_H
@@ -0,0 +1,156 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "DirectoryWatcher.h"
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                       IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                       IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+
+DirectoryWatcher::DirectoryWatcher(Listener listener) : _listener(std::move(listener)) {}
+
+
+DirectoryWatcher::~DirectoryWatcher() {
+    stop();
+}
+
+
+bool DirectoryWatcher::start() {
+    if (_thread.joinable()) {
+        return true;
+    }
+
+    _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_inotify_fd == -1 || _wake_fd == -1) {
+        stop();
+        return false;
+    }
+
+    _thread = thread([this] {
+        run();
+    });
+    return true;
+}
+
+
+void DirectoryWatcher::stop() {
+    if (_thread.joinable()) {
+        uint64_t one = 1;
+        (void) write(_wake_fd, &one, sizeof(one));
+        _thread.join();
+    }
+    if (_inotify_fd != -1) {
+        close(_inotify_fd);
+        _inotify_fd = -1;
+    }
+    if (_wake_fd != -1) {
+        close(_wake_fd);
+        _wake_fd = -1;
+    }
+
+    lock_guard lock(_mutex);
+    _watches.clear();
+}
+
+
+bool DirectoryWatcher::add_directory(const std::string &dir_path) {
+    if (_inotify_fd == -1) {
+        return false;
+    }
+
+    // 与事件线程共用一把锁: 新目录的事件在登记完成后才会被分发
+    lock_guard lock(_mutex);
+    int wd = inotify_add_watch(_inotify_fd, dir_path.c_str(), WATCH_MASK);
+    if (wd == -1) {
+        return false;
+    }
+    _watches[wd] = dir_path;
+    return true;
+}
+
+
+void DirectoryWatcher::run() {
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    struct pollfd fds[2] = {
+            {_inotify_fd, POLLIN, 0},
+            {_wake_fd, POLLIN, 0},
+    };
+
+    while (true) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        // 非阻塞读, 一次唤醒尽量取完队列中的事件
+        while (true) {
+            ssize_t n = read(_inotify_fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                break;
+            }
+            for (char* p = buffer; p < buffer + n;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(p);
+                dispatch(*event);
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+
+void DirectoryWatcher::dispatch(const struct inotify_event &event) {
+    if (event.mask & IN_Q_OVERFLOW) {
+        _listener(Event::OVERFLOW, string());
+        return;
+    }
+
+    // 目录被移走后监听仍跟随原 inode, 路径已不可用, 与目录删除一样按失效处理
+    const bool unwatched = event.mask & (IN_MOVE_SELF | IN_IGNORED);
+    string dir_path;
+    {
+        lock_guard lock(_mutex);
+        auto it = _watches.find(event.wd);
+        if (it == _watches.end()) {
+            return;
+        }
+        dir_path = it->second;
+        if (unwatched) {
+            _watches.erase(it);
+            if (event.mask & IN_MOVE_SELF) {
+                inotify_rm_watch(_inotify_fd, event.wd);
+            }
+        }
+    }
+
+    if (unwatched) {
+        _listener(Event::UNWATCHED, dir_path);
+        return;
+    }
+    // 删除目录时随后还会收到 IN_IGNORED, 在那里统一通知
+    if (event.mask & IN_DELETE_SELF) {
+        return;
+    }
+    if (event.len == 0 || (event.mask & IN_ISDIR)) {
+        return;
+    }
+
+    const string path = dir_path + "/" + event.name;
+    if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+        _listener(Event::REMOVED, path);
+    } else {
+        _listener(Event::MODIFIED, path);
+    }
+}
@@ -0,0 +1,62 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_DIRECTORYWATCHER_H
+#define ANDROIDX_JETPACK_DIRECTORYWATCHER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <sys/inotify.h>
+
+using namespace std;
+
+/**
+ * 目录变更监听
+ * 单个后台线程读取 inotify 事件, 把目录内文件的变更转换为按路径的回调; 只监听目录本身, 不递归子目录
+ */
+class DirectoryWatcher {
+
+public:
+    enum class Event {
+        MODIFIED,       // 文件被创建, 写入或属性变化
+        REMOVED,        // 文件被删除或移出目录
+        UNWATCHED,      // 目录本身被删除或移走, path 为目录路径, 监听已失效
+        OVERFLOW,       // 内核事件队列溢出, 部分事件丢失, path 为空
+    };
+
+    using Listener = function<void(Event event, const string& path)>;
+
+    explicit DirectoryWatcher(Listener listener);
+
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    bool start();
+
+    void stop();
+
+    // 可在任意线程调用; 重复添加同一目录只保留一个监听
+    bool add_directory(const string& dir_path);
+
+private:
+    void run();
+
+    void dispatch(const struct inotify_event& event);
+
+    Listener _listener;
+    int _inotify_fd = -1;
+    int _wake_fd = -1;
+    thread _thread;
+    mutex _mutex;
+    unordered_map<int, string> _watches;   // watch descriptor -> 目录路径
+};
+
+
+#endif //ANDROIDX_JETPACK_DIRECTORYWATCHER_H
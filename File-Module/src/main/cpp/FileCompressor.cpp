@@ -0,0 +1,175 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "FileCompressor.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <zlib.h>
+
+
+string FileCompressor::compress(const std::string &raw, size_t max_threads) {
+    const size_t block_count = (raw.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (block_count <= 1) {
+        return raw.empty() ? string() : compress_block(raw.data(), raw.size());
+    }
+
+    // 各块互不依赖, 由调用线程与最多 max_threads - 1 个辅助线程按序号领取
+    vector<string> frames(block_count);
+    atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i = next.fetch_add(1); i < block_count; i = next.fetch_add(1)) {
+            const size_t offset = i * BLOCK_SIZE;
+            frames[i] = compress_block(raw.data() + offset, min(BLOCK_SIZE, raw.size() - offset));
+        }
+    };
+
+    vector<thread> helpers;
+    const size_t helper_count = min(max(max_threads, static_cast<size_t>(1)), block_count) - 1;
+    for (size_t i = 0; i < helper_count; ++i) {
+        helpers.emplace_back(work);
+    }
+    work();
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    size_t total = 0;
+    for (const auto& frame : frames) {
+        total += frame.size();
+    }
+    string output;
+    output.reserve(total);
+    for (const auto& frame : frames) {
+        output.append(frame);
+    }
+    return output;
+}
+
+
+string FileCompressor::store(const std::string &raw) {
+    string output;
+    output.reserve(raw.size() + (raw.size() / BLOCK_SIZE + 1) * sizeof(FrameHeader));
+    for (size_t offset = 0; offset < raw.size(); offset += BLOCK_SIZE) {
+        output.append(store_block(raw.data() + offset, min(BLOCK_SIZE, raw.size() - offset)));
+    }
+    return output;
+}
+
+
+bool FileCompressor::is_compressed(const char *data, size_t size) {
+    uint32_t magic;
+    if (size < sizeof(FrameHeader)) {
+        return false;
+    }
+    memcpy(&magic, data, sizeof(magic));
+    return magic == FRAME_MAGIC;
+}
+
+
+bool FileCompressor::is_framed(const char *data, size_t size) {
+    if (size == 0) {
+        return false;
+    }
+    for (size_t offset = 0; offset < size;) {
+        if (size - offset < sizeof(FrameHeader)) {
+            return false;
+        }
+        const uint64_t length = frame_length(data + offset, size - offset - sizeof(FrameHeader));
+        if (length == 0) {
+            return false;
+        }
+        offset += length;
+    }
+    return true;
+}
+
+
+uint64_t FileCompressor::frame_length(const char *header_data, uint64_t remaining) {
+    FrameHeader header;
+    memcpy(&header, header_data, sizeof(header));
+    if (header.magic != FRAME_MAGIC || (header.flags & ~FLAG_STORED) != 0 || header.stored_size > remaining ||
+        header.raw_size == 0 || header.raw_size > BLOCK_SIZE ||
+        ((header.flags & FLAG_STORED) && header.stored_size != header.raw_size) ||
+        static_cast<uint64_t>(header.raw_size) > static_cast<uint64_t>(header.stored_size) * MAX_DEFLATE_RATIO) {
+        return 0;
+    }
+    return sizeof(header) + header.stored_size;
+}
+
+
+bool FileCompressor::decompress(const char *data, size_t size, std::string &output) {
+    // 先校验整个文件的帧结构并求出原始长度, 只分配一次
+    size_t raw_total = 0;
+    for (size_t offset = 0; offset < size;) {
+        if (size - offset < sizeof(FrameHeader)) {
+            return false;
+        }
+        const uint64_t length = frame_length(data + offset, size - offset - sizeof(FrameHeader));
+        if (length == 0) {
+            return false;
+        }
+        FrameHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        offset += length;
+        if (header.raw_size > numeric_limits<size_t>::max() - raw_total) {
+            return false;
+        }
+        raw_total += header.raw_size;
+    }
+
+    string result(raw_total, '\0');
+    size_t written = 0;
+    for (size_t offset = 0; offset < size;) {
+        FrameHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.flags & FLAG_STORED) {
+            memcpy(result.data() + written, data + offset, header.raw_size);
+        } else {
+            uLongf dest_size = header.raw_size;
+            if (uncompress(reinterpret_cast<Bytef*>(result.data() + written), &dest_size,
+                           reinterpret_cast<const Bytef*>(data + offset), header.stored_size) != Z_OK ||
+                dest_size != header.raw_size) {
+                return false;
+            }
+        }
+        offset += header.stored_size;
+        written += header.raw_size;
+    }
+
+    output = std::move(result);
+    return true;
+}
+
+
+string FileCompressor::compress_block(const char *data, size_t size) {
+    FrameHeader header{FRAME_MAGIC, 0, static_cast<uint32_t>(size), 0};
+    string frame(sizeof(header) + compressBound(size), '\0');
+
+    // 文本与 JSON 在最快级别下已有数倍压缩比, 写入线程上的耗时更重要
+    uLongf stored_size = compressBound(size);
+    int result = compress2(reinterpret_cast<Bytef*>(frame.data() + sizeof(header)), &stored_size,
+                           reinterpret_cast<const Bytef*>(data), size, Z_BEST_SPEED);
+    if (result != Z_OK || stored_size >= size) {
+        return store_block(data, size);
+    }
+
+    frame.resize(sizeof(header) + stored_size);
+    header.stored_size = static_cast<uint32_t>(stored_size);
+    memcpy(frame.data(), &header, sizeof(header));
+    return frame;
+}
+
+
+string FileCompressor::store_block(const char *data, size_t size) {
+    const FrameHeader header{FRAME_MAGIC, FLAG_STORED, static_cast<uint32_t>(size), static_cast<uint32_t>(size)};
+    string frame(sizeof(header) + size, '\0');
+    memcpy(frame.data(), &header, sizeof(header));
+    memcpy(frame.data() + sizeof(header), data, size);
+    return frame;
+}
@@ -0,0 +1,65 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_FILECOMPRESSOR_H
+#define ANDROIDX_JETPACK_FILECOMPRESSOR_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * 文件内容压缩
+ * 内容按块独立压缩为帧, 每帧带魔数与长度头; 文件是帧的顺序拼接, 追加写只需在末尾追加新的帧
+ * 大内容的各块并行压缩; 压缩后不变小的块原样保存
+ */
+class FileCompressor {
+
+public:
+    static constexpr size_t BLOCK_SIZE = 256 * 1024;
+    static constexpr size_t MAX_THREADS = 4;
+
+    // 空内容压缩结果为空
+    static string compress(const string& raw, size_t max_threads = MAX_THREADS);
+
+    // 原样封装为不压缩的帧, 压缩关闭后向已压缩的文件追加时使用
+    static string store(const string& raw);
+
+    // 以帧魔数开头即视为压缩格式
+    static bool is_compressed(const char* data, size_t size);
+
+    // 完整校验帧结构, 恰好以魔数开头的普通内容返回 false
+    static bool is_framed(const char* data, size_t size);
+
+    static constexpr size_t FRAME_HEADER_SIZE = 16;
+
+    // 校验 header 处的帧头, remaining 为帧头之后的字节数; 通过时返回整帧长度 (含帧头), 否则返回 0
+    // 写入方只产生 1 到 BLOCK_SIZE 字节的块, 声明的原始长度超出该范围或超出 deflate 的最大压缩比时视为损坏
+    static uint64_t frame_length(const char* header, uint64_t remaining);
+
+    // 帧头与长度必须与数据完全吻合, 否则返回 false 且不修改 output
+    static bool decompress(const char* data, size_t size, string& output);
+
+private:
+    static constexpr uint32_t FRAME_MAGIC = 0x315A4D46; // "FMZ1"
+    static constexpr uint32_t FLAG_STORED = 1;          // 块未压缩
+    static constexpr uint64_t MAX_DEFLATE_RATIO = 1032; // deflate 输出与输入之比的理论上限
+
+    struct FrameHeader {
+        uint32_t magic;
+        uint32_t flags;
+        uint32_t raw_size;
+        uint32_t stored_size;
+    };
+    static_assert(sizeof(FrameHeader) == FRAME_HEADER_SIZE, "frame header layout");
+
+    static string compress_block(const char* data, size_t size);
+
+    static string store_block(const char* data, size_t size);
+};
+
+
+#endif //ANDROIDX_JETPACK_FILECOMPRESSOR_H
@@ -0,0 +1,148 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "FileContentCache.h"
+
+
+FileContentCache::FileContentCache(size_t byte_budget, size_t shard_count)
+        : _byte_budget(byte_budget) {
+    size_t count = shard_count > 0 ? shard_count : 1;
+    _shard_budget = _byte_budget / count;
+    _shards.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        _shards.push_back(make_unique<Shard>());
+    }
+}
+
+
+FileContentCache::Content FileContentCache::get(const std::string &path,
+                                                FileTime mtime,
+                                                uint64_t file_size) {
+    Shard& shard = shard_for(path);
+    lock_guard lock(shard.m_mutex);
+
+    auto it = shard.index.find(path);
+    if (it == shard.index.end()) {
+        return nullptr;
+    }
+
+    auto entry = it->second;
+    if (entry->mtime != mtime || entry->file_size != file_size) {
+        // 磁盘上的文件已变化, 丢弃旧内容
+        erase_locked(shard, entry);
+        return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+    return entry->content;
+}
+
+
+uint64_t FileContentCache::generation(const std::string &path) const {
+    Shard& shard = shard_for(path);
+    lock_guard lock(shard.m_mutex);
+    return shard.generation;
+}
+
+
+bool FileContentCache::put(const std::string &path, Content content, FileTime mtime, uint64_t file_size,
+                           uint64_t generation) {
+    if (!content) {
+        return false;
+    }
+
+    Shard& shard = shard_for(path);
+    lock_guard lock(shard.m_mutex);
+
+    // 读取期间有写入完成, 读到的内容可能早于当前版本
+    if (shard.generation != generation) {
+        return false;
+    }
+
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+        erase_locked(shard, it->second);
+    }
+
+    // 超过单个分片预算的大文件不缓存, 避免一次写入清空整个分片
+    const size_t entry_size = content->size();
+    if (entry_size > _shard_budget) {
+        return false;
+    }
+
+    while (shard.bytes + entry_size > _shard_budget && !shard.lru.empty()) {
+        erase_locked(shard, prev(shard.lru.end()));
+    }
+
+    shard.lru.push_front(Entry{path, std::move(content), mtime, file_size});
+    shard.index[path] = shard.lru.begin();
+    shard.bytes += entry_size;
+    return true;
+}
+
+
+void FileContentCache::invalidate(const std::string &path) {
+    Shard& shard = shard_for(path);
+    lock_guard lock(shard.m_mutex);
+
+    shard.generation++;
+    auto it = shard.index.find(path);
+    if (it != shard.index.end()) {
+        erase_locked(shard, it->second);
+    }
+}
+
+
+void FileContentCache::clear() {
+    for (auto& shard : _shards) {
+        lock_guard lock(shard->m_mutex);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+        shard->generation++;
+    }
+}
+
+
+size_t FileContentCache::trim(size_t target_bytes) {
+    const size_t shard_target = target_bytes / _shards.size();
+    size_t released = 0;
+    for (auto& shard : _shards) {
+        lock_guard lock(shard->m_mutex);
+        while (shard->bytes > shard_target && !shard->lru.empty()) {
+            auto last = prev(shard->lru.end());
+            released += last->content->size();
+            erase_locked(*shard, last);
+        }
+    }
+    return released;
+}
+
+
+size_t FileContentCache::byte_size() const {
+    size_t total = 0;
+    for (const auto& shard : _shards) {
+        lock_guard lock(shard->m_mutex);
+        total += shard->bytes;
+    }
+    return total;
+}
+
+
+size_t FileContentCache::byte_budget() const {
+    return _byte_budget;
+}
+
+
+FileContentCache::Shard &FileContentCache::shard_for(const std::string &path) const {
+    size_t h = hash<string>{}(path);
+    return *_shards[h % _shards.size()];
+}
+
+
+void FileContentCache::erase_locked(Shard &shard, EntryList::iterator it) {
+    shard.bytes -= it->content->size();
+    shard.index.erase(it->path);
+    shard.lru.erase(it);
+}
@@ -0,0 +1,80 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_FILECONTENTCACHE_H
+#define ANDROIDX_JETPACK_FILECONTENTCACHE_H
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <filesystem>
+#include <functional>
+
+using namespace std;
+
+/**
+ * 文件内容缓存
+ * 以总字节数为上限, 按大小感知的 LRU 淘汰; 命中时校验 mtime 与文件大小, 不一致视为失效
+ * 每个分片维护失效代数: 读取磁盘前取得代数, 期间发生过 invalidate 时 put 拒绝写入, 旧内容不会覆盖新版本
+ */
+class FileContentCache {
+
+public:
+    using Content = shared_ptr<const string>;
+    using FileTime = filesystem::file_time_type;
+
+    explicit FileContentCache(size_t byte_budget, size_t shard_count = 8);
+
+    Content get(const string& path, FileTime mtime, uint64_t file_size);
+
+    // 在读取磁盘之前调用, 结果传给 put
+    uint64_t generation(const string& path) const;
+
+    // file_size 为磁盘上的文件大小, 压缩存储时与内容长度不同
+    // generation 之后该分片发生过 invalidate 或 clear 时不写入, 返回 false
+    bool put(const string& path, Content content, FileTime mtime, uint64_t file_size, uint64_t generation);
+
+    void invalidate(const string& path);
+
+    void clear();
+
+    // 按 LRU 淘汰到总字节数不超过 target_bytes, 返回释放的字节数
+    size_t trim(size_t target_bytes);
+
+    size_t byte_size() const;
+
+    size_t byte_budget() const;
+
+private:
+    struct Entry {
+        string path;
+        Content content;
+        FileTime mtime;
+        uint64_t file_size;
+    };
+
+    using EntryList = list<Entry>;
+
+    struct Shard {
+        mutex m_mutex;
+        EntryList lru;
+        unordered_map<string, EntryList::iterator> index;
+        size_t bytes = 0;
+        uint64_t generation = 0;
+    };
+
+    Shard& shard_for(const string& path) const;
+
+    void erase_locked(Shard& shard, EntryList::iterator it);
+
+    size_t _byte_budget;
+    size_t _shard_budget;
+    vector<unique_ptr<Shard>> _shards;
+};
+
+
+#endif //ANDROIDX_JETPACK_FILECONTENTCACHE_H
@@ -20,12 +20,21 @@ FileInterface &FileInterface::getInstance() {
 
 
 bool
-FileInterface::initManager(const std::string &base_path, size_t cache_capacity, bool use_async_writer) {
+FileInterface::initManager(const std::string &base_path, size_t cache_capacity, bool use_async_writer,
+                           size_t writer_threads, size_t journal_bytes, bool watch_directories,
+                           bool cross_process_locks) {
     try {
+        // 先析构旧实例释放预写日志的 flock, 新实例才能重放并接管日志
+        g_file_manager.reset();
         g_file_manager = std::make_unique<FileManager>(
                 base_path,
                 cache_capacity,
-                use_async_writer
+                use_async_writer,
+                FileManager::DEFAULT_CONTENT_CACHE_BYTES,
+                writer_threads,
+                journal_bytes,
+                watch_directories,
+                cross_process_locks
         );
         return true;
     } catch (const std::exception& e) {
@@ -62,6 +71,36 @@ bool FileInterface::read_file(const std::string &business_id, const std::string
 }
 
 
+AtomicFileOperator::MappedView FileInterface::map_file(const std::string &business_id,
+                                                      const std::string &filename) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return nullptr;
+    }
+    return g_file_manager->map_file(business_id, filename);
+}
+
+
+AtomicFileOperator::ReadStream FileInterface::open_read_stream(const std::string &business_id,
+                                                              const std::string &filename) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return nullptr;
+    }
+    return g_file_manager->open_read_stream(business_id, filename);
+}
+
+
+AtomicFileOperator::WriteStream FileInterface::open_write_stream(const std::string &business_id,
+                                                                const std::string &filename) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return nullptr;
+    }
+    return g_file_manager->open_write_stream(business_id, filename);
+}
+
+
 bool FileInterface::update_file(const std::string &business_id, const std::string &filename,
                                 const std::string &content) {
     if (!g_file_manager) {
@@ -92,6 +131,18 @@ bool FileInterface::delete_file(const std::string &business_id, const std::strin
 }
 
 
+future<bool> FileInterface::submit_write(WriteType type, const std::string &business_id,
+                                         const std::string &filename, const std::string &content) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        promise<bool> result;
+        result.set_value(false);
+        return result.get_future();
+    }
+    return g_file_manager->write_file(type, business_id, filename, content, Durability::NONE);
+}
+
+
 bool FileInterface::file_exists(const std::string &business_id, const std::string &filename) {
     if (!g_file_manager) {
         LOGE(TAG, "FileManager not initialized");
@@ -101,6 +152,36 @@ bool FileInterface::file_exists(const std::string &business_id, const std::strin
     return g_file_manager->file_exists(business_id, filename);
 }
 
+
+vector<bool> FileInterface::batch_read(const vector<FileManager::BatchRead> &reads,
+                                       vector<std::string> &outputs) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        outputs.assign(reads.size(), string());
+        return vector<bool>(reads.size(), false);
+    }
+    return g_file_manager->batch_read(reads, outputs);
+}
+
+
+vector<bool> FileInterface::batch_write(vector<FileManager::BatchWrite> writes) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return vector<bool>(writes.size(), false);
+    }
+    return g_file_manager->batch_write(std::move(writes));
+}
+
+future<vector<bool>> FileInterface::submit_batch(vector<FileManager::BatchWrite> writes) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        promise<vector<bool>> result;
+        result.set_value(vector<bool>(writes.size(), false));
+        return result.get_future();
+    }
+    return g_file_manager->submit_batch(std::move(writes), Durability::NONE);
+}
+
 void FileInterface::prefetch_directory(const std::string &business_id,
                                        const std::string &sub_str,
                                        const int32_t day,
@@ -111,4 +192,64 @@ void FileInterface::prefetch_directory(const std::string &business_id,
         return;
     }
     g_file_manager->prefetch_directory(business_id, sub_str, day, flag,files);
-}
\ No newline at end of file
+}
+
+
+bool FileInterface::prefetch_directory(const std::string &business_id,
+                                       const std::string &sub_str,
+                                       const int32_t day,
+                                       const bool flag,
+                                       size_t page_size,
+                                       const FileManager::PageCallback &on_page) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return false;
+    }
+    return g_file_manager->prefetch_directory(business_id, sub_str, day, flag, page_size, on_page);
+}
+
+
+void FileInterface::set_compression(const std::string &business_id, bool enabled) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return;
+    }
+    g_file_manager->set_compression(business_id, enabled);
+}
+
+
+bool FileInterface::enable_packed_storage(const std::string &business_id) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return false;
+    }
+    return g_file_manager->enable_packed_storage(business_id);
+}
+
+
+int FileInterface::set_io_backend(int kind) {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return static_cast<int>(IoBackend::Kind::SYNC);
+    }
+    auto requested = kind == static_cast<int>(IoBackend::Kind::IO_URING)
+                     ? IoBackend::Kind::IO_URING : IoBackend::Kind::SYNC;
+    return static_cast<int>(g_file_manager->set_io_backend(requested));
+}
+
+
+void FileInterface::flush_writes() {
+    if (!g_file_manager) {
+        LOGE(TAG, "FileManager not initialized");
+        return;
+    }
+    g_file_manager->flush_writes();
+}
+
+
+void FileInterface::on_trim_memory(int level) {
+    if (!g_file_manager) {
+        return;
+    }
+    g_file_manager->on_trim_memory(level);
+}
@@ -17,7 +17,9 @@ class FileInterface {
 public:
     static FileInterface &getInstance();
 
-    bool initManager(const string& base_path, size_t cache_capacity, bool use_async_writer);
+    bool initManager(const string& base_path, size_t cache_capacity, bool use_async_writer,
+                     size_t writer_threads = 1, size_t journal_bytes = 0,
+                     bool watch_directories = false, bool cross_process_locks = false);
 
     bool create_file(const string& business_id,
                      const string& filename,
@@ -27,6 +29,15 @@ public:
                    const string& filename,
                    string& output);
 
+    AtomicFileOperator::MappedView map_file(const string& business_id,
+                                            const string& filename);
+
+    AtomicFileOperator::ReadStream open_read_stream(const string& business_id,
+                                                    const string& filename);
+
+    AtomicFileOperator::WriteStream open_write_stream(const string& business_id,
+                                                      const string& filename);
+
     bool update_file(const string& business_id,
                      const string& filename,
                      const string& content);
@@ -38,15 +49,46 @@ public:
     bool delete_file(const string& business_id,
                      const string& filename);
 
+    // 提交写入, 返回的 future 在写入执行完成后就绪; 异步模式下上面的 bool 接口只表示已入队, 需要真实结果时使用
+    future<bool> submit_write(WriteType type,
+                              const string& business_id,
+                              const string& filename,
+                              const string& content);
+
     bool file_exists(const string& business_id,
                      const string& filename);
 
+    vector<bool> batch_read(const vector<FileManager::BatchRead>& reads,
+                            vector<string>& outputs);
+
+    vector<bool> batch_write(vector<FileManager::BatchWrite> writes);
+
+    // 返回的 future 在整批执行完成后就绪, 按 writes 的顺序给出每个写入的结果
+    future<vector<bool>> submit_batch(vector<FileManager::BatchWrite> writes);
+
     void prefetch_directory(const string& business_id,
                             const string& sub_str,
                             const int32_t day,
                             const bool flag,
                             vector<string> &files);
 
+    bool prefetch_directory(const string& business_id,
+                            const string& sub_str,
+                            const int32_t day,
+                            const bool flag,
+                            size_t page_size,
+                            const FileManager::PageCallback& on_page);
+
+    void set_compression(const string& business_id, bool enabled);
+
+    bool enable_packed_storage(const string& business_id);
+
+    int set_io_backend(int kind);
+
+    void flush_writes();
+
+    void on_trim_memory(int level);
+
 
 private:
     FileInterface();
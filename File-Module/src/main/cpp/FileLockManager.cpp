@@ -3,43 +3,184 @@
 //
 
 #include "FileLockManager.h"
+#include <cerrno>
+#include <limits>
 
 
-void FileLockManager::FileLock::lock_shared() {
+FileLockManager::FileLock::FileLock(int fd, off_t offset) : _fd(fd), _offset(offset) {}
+
+bool FileLockManager::FileLock::lock_shared() {
     _mutex.lock_shared();
+    if (_fd != -1) {
+        lock_guard guard(_readers_mutex);
+        if (_readers == 0 && !lock_process(F_RDLCK)) {
+            _mutex.unlock_shared();
+            return false;
+        }
+        _readers++;
+    }
+    return true;
 }
 
 void FileLockManager::FileLock::unlock_shared() {
+    if (_fd != -1) {
+        lock_guard guard(_readers_mutex);
+        if (--_readers == 0) {
+            lock_process(F_UNLCK);
+        }
+    }
     _mutex.unlock_shared();
 }
 
-void FileLockManager::FileLock::lock() {
-    _mutex.lock();
+bool FileLockManager::FileLock::lock() {
+    // 先等待 pin 全部释放再加写锁, 等待期间不阻塞新的读者; 加锁后没有读锁就不会产生新的 pin
+    while (true) {
+        {
+            unique_lock guard(_pins_mutex);
+            _pins_cv.wait(guard, [this] { return _pins == 0; });
+        }
+        _mutex.lock();
+        {
+            lock_guard guard(_pins_mutex);
+            if (_pins == 0) {
+                break;
+            }
+        }
+        _mutex.unlock();
+    }
+    if (_fd != -1 && !lock_process(F_WRLCK)) {
+        _mutex.unlock();
+        return false;
+    }
+    return true;
 }
 
 void FileLockManager::FileLock::unlock() {
+    if (_fd != -1) {
+        lock_process(F_UNLCK);
+    }
     _mutex.unlock();
 }
 
+bool FileLockManager::FileLock::pin() {
+    if (!lock_shared()) {
+        return false;
+    }
+    {
+        lock_guard guard(_pins_mutex);
+        _pins++;
+    }
+    // pin 作为一个读者保留跨进程读锁
+    if (_fd != -1) {
+        lock_guard guard(_readers_mutex);
+        _readers++;
+    }
+    unlock_shared();
+    return true;
+}
+
+void FileLockManager::FileLock::unpin() {
+    // 先释放跨进程读锁再减少计数, 等待中的写者拿到写锁时读锁已释放
+    if (_fd != -1) {
+        lock_guard guard(_readers_mutex);
+        if (--_readers == 0) {
+            lock_process(F_UNLCK);
+        }
+    }
+    lock_guard guard(_pins_mutex);
+    if (--_pins == 0) {
+        _pins_cv.notify_all();
+    }
+}
+
+bool FileLockManager::FileLock::lock_process(short type) {
+    struct flock fl {};
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = _offset;
+    fl.l_len = 1;
+    fl.l_pid = 0;
+
+    // OFD 锁归属于打开的文件描述, 不随线程或同进程其他 fd 的关闭而释放;
+    // 内核不支持 (3.15 之前) 时退化为进程级记录锁, 进程内的互斥已由 shared_mutex 保证
+    // 其他错误 (ENOLCK, EDEADLK 等) 时没有取得跨进程锁, 返回 false
+    int cmd = F_OFD_SETLKW;
+    while (fcntl(_fd, cmd, &fl) != 0) {
+        if (errno == EINVAL && cmd == F_OFD_SETLKW) {
+            cmd = F_SETLKW;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FileLockManager::FileLockManager(const std::string &lock_file_path) {
+    if (!lock_file_path.empty()) {
+        _lock_fd = open(lock_file_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    }
+}
+
+FileLockManager::~FileLockManager() {
+    if (_lock_fd != -1) {
+        close(_lock_fd);
+    }
+}
+
 FileLockManager::LockPtr FileLockManager::get_lock(const std::string &file_path) {
-    lock_guard map_lock(m_mutex);
-    auto it = _locks.find(file_path);
-    if (it != _locks.end()) {
-        return it->second;
+    Shard& shard = shard_for(file_path);
+
+    // 快速路径: 已存在的锁只需共享锁查表
+    {
+        shared_lock map_lock(shard.m_mutex);
+        auto it = shard.locks.find(file_path);
+        if (it != shard.locks.end()) {
+            return it->second;
+        }
     }
 
-    auto lock_ptr = make_shared<FileLock>();
-    _locks.emplace(file_path, lock_ptr);
-    return lock_ptr;
+    unique_lock map_lock(shard.m_mutex);
+    auto [it, inserted] = shard.locks.try_emplace(file_path);
+    if (inserted) {
+        it->second = _lock_fd != -1 ? make_shared<FileLock>(_lock_fd, lock_offset(file_path))
+                                    : make_shared<FileLock>();
+    }
+    return it->second;
 }
 
 void FileLockManager::cleanup_unused() {
-    lock_guard map_lock(m_mutex);
-    for (auto it = _locks.begin(); it != _locks.end();) {
-        if (it->second.use_count() == 1) {
-            it = _locks.erase(it);
-        } else {
-            ++it;
+    for (auto& shard : _shards) {
+        unique_lock map_lock(shard.m_mutex);
+        for (auto it = shard.locks.begin(); it != shard.locks.end();) {
+            // 持有分片写锁时不会有新的引用产生, use_count 为 1 说明只剩表内这一份
+            if (it->second.use_count() == 1) {
+                it = shard.locks.erase(it);
+            } else {
+                ++it;
+            }
         }
     }
-}
\ No newline at end of file
+}
+
+size_t FileLockManager::size() const {
+    size_t total = 0;
+    for (const auto& shard : _shards) {
+        shared_lock map_lock(shard.m_mutex);
+        total += shard.locks.size();
+    }
+    return total;
+}
+
+FileLockManager::Shard &FileLockManager::shard_for(const std::string &file_path) {
+    return _shards[hash<string>()(file_path) % SHARD_COUNT];
+}
+
+off_t FileLockManager::lock_offset(const std::string &file_path) {
+    // FNV-1a 64 位, 截断到 off_t 正数范围 (32 位 ABI 上只有 31 位); 区间只锁 1 字节, 锁文件本身保持为空
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : file_path) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return static_cast<off_t>(h & static_cast<uint64_t>(numeric_limits<off_t>::max()));
+}
@@ -9,37 +9,97 @@
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <condition_variable>
 #include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
 /**
  * 文件锁管理系统
+ * 路径到锁的映射按路径哈希分片, 每个分片独立加锁; 每个路径仍有自己的 FileLock,
+ * 不相关的路径不会共用文件锁, 只在落入同一分片时短暂竞争一次查表
+ * 跨进程模式下每个 FileLock 额外对应锁文件中的一个字节区间 (按路径哈希定位), 用 OFD 记录锁与其他进程互斥;
+ * 进程内仍由 shared_mutex 协调, 只有第一个读者和写者需要系统调用
+ * 加锁返回 false 表示跨进程锁失败 (此时进程内的锁也已释放), 调用方应放弃本次操作; 成功后以 adopt_lock 交给 RAII 包装
+ * 映射视图与读取流使用 pin/unpin: 与读锁同样阻止写入, 但不绑定线程, 可以在任意线程上释放
  */
 class FileLockManager {
 
 public:
     class FileLock{
     public:
-        void lock_shared();
+        FileLock() = default;
+
+        // fd 为 -1 时只在进程内加锁
+        FileLock(int fd, off_t offset);
+
+        bool lock_shared();
         void unlock_shared();
-        void lock();
+        bool lock();
         void unlock();
 
+        // 长期持有的读引用; shared_mutex 必须在加锁的线程上解锁, pin 只在加锁的线程上短暂持有读锁,
+        // 之后由计数阻止写入, unpin 可以在任意线程上调用
+        bool pin();
+        void unpin();
+
     private:
+        bool lock_process(short type);
+
         shared_mutex _mutex;
+        int _fd = -1;
+        off_t _offset = 0;
+        mutex _readers_mutex;
+        size_t _readers = 0;    // 进程内的读者数 (含 pin), 由第一个读者加锁, 最后一个读者解锁
+        mutex _pins_mutex;
+        condition_variable _pins_cv;
+        size_t _pins = 0;
     };
 
     using LockPtr = shared_ptr<FileLock>;
 
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr const char* LOCK_FILENAME = ".file_locks";
+
+    // lock_file_path 非空时开启跨进程模式, 所有进程应使用同一个锁文件; 打开失败时退化为进程内锁
+    explicit FileLockManager(const string& lock_file_path = "");
+
+    ~FileLockManager();
+
+    FileLockManager(const FileLockManager&) = delete;
+
+    FileLockManager& operator=(const FileLockManager&) = delete;
+
+    bool cross_process() const {
+        return _lock_fd != -1;
+    }
+
     LockPtr get_lock(const string& file_path);
 
+    // 逐个分片清理, 同一时刻只阻塞一个分片的查表
     void cleanup_unused();
 
+    size_t size() const;
+
 
 private:
-    unordered_map<string, LockPtr> _locks;
-    mutex m_mutex;
+    // 独占缓存行, 相邻分片的锁不会伪共享
+    struct alignas(64) Shard {
+        unordered_map<string, LockPtr> locks;
+        mutable shared_mutex m_mutex;
+    };
+
+    Shard& shard_for(const string& file_path);
+
+    // 进程间必须一致, 不能使用实现相关的 std::hash
+    static off_t lock_offset(const string& file_path);
+
+    array<Shard, SHARD_COUNT> _shards;
+    int _lock_fd = -1;
 };
 
 
@@ -3,19 +3,76 @@
 //
 
 #include "FileManager.h"
+#include <numeric>
 
 #define LOG_TAG "FileManager"
 
 FileManager::FileManager(const string &base_path,
                          size_t cache_capacity,
-                         bool use_async_writer)
+                         bool use_async_writer,
+                         size_t content_cache_bytes,
+                         size_t writer_threads,
+                         size_t journal_bytes,
+                         bool watch_directories,
+                         bool cross_process_locks)
         : _directory_manager(base_path),
-          _lock_manager(),
+          _lock_manager(cross_process_locks
+                        ? (filesystem::path(base_path) / FileLockManager::LOCK_FILENAME).string()
+                        : string()),
           _file_operator(_lock_manager),
           _cache(cache_capacity),
-          _metadata_manager(),
+          _content_cache(content_cache_bytes),
+          // 跨进程模式下其他进程随时可能改写文件, 元数据每次访问都重新 stat
+          _metadata_manager(max(cache_capacity, FileMetadataManager::DEFAULT_MAX_ENTRIES),
+                            cross_process_locks ? chrono::milliseconds(0) : FileMetadataManager::DEFAULT_FRESHNESS),
           _use_async_writer(use_async_writer),
-          _stop_cleanup(false) {
+          _writer_threads(writer_threads),
+          _cross_process(cross_process_locks) {
+
+    if (cross_process_locks && !_lock_manager.cross_process()) {
+        LOGE(LOG_TAG, "Failed to open lock file, cross-process locking disabled");
+    }
+
+    // 先重放上次进程退出时未执行的写入, 再开始接受新的请求
+    // 日志被同一 basePath 上仍在运行的实例持有时, 不重放也不截断它的记录, 本实例不使用日志
+    const string journal_path = (filesystem::path(base_path) / WriteAheadJournal::JOURNAL_FILENAME).string();
+    const int journal_fd = WriteAheadJournal::acquire(journal_path);
+    if (journal_fd == -1) {
+        LOGW(LOG_TAG, "Write journal %s is held by another instance", journal_path.c_str());
+    } else {
+        replay_journal(journal_fd);
+        if (_use_async_writer && journal_bytes > 0) {
+            _journal = make_unique<WriteAheadJournal>();
+            if (!_journal->open(journal_fd, journal_bytes)) {
+                LOGE(LOG_TAG, "Failed to open write journal %s", journal_path.c_str());
+                _journal.reset();
+            }
+        } else {
+            // 持有 flock 期间删除, 其他实例不会在删除前重放到已执行的记录
+            unlink(journal_path.c_str());
+            close(journal_fd);
+        }
+    }
+
+    // 监听业务目录, 其他进程的修改通过通知失效缓存, 命中校验不再需要 stat
+    // 跨进程模式总是监听以维护目录索引, 但元数据仍每次 stat, 不受通知延迟影响
+    if (watch_directories || _cross_process) {
+        _watcher = make_unique<DirectoryWatcher>([this](DirectoryWatcher::Event event, const string& path) {
+            on_directory_event(event, path);
+        });
+        if (_watcher->start()) {
+            _directory_manager.set_directory_listener([this](const string& dir_path) {
+                if (!_watcher->add_directory(dir_path)) {
+                    LOGW(LOG_TAG, "Failed to watch directory %s", dir_path.c_str());
+                } else if (!_cross_process) {
+                    _metadata_manager.watch_directory(dir_path);
+                }
+            });
+        } else {
+            LOGE(LOG_TAG, "Failed to start directory watcher");
+            _watcher.reset();
+        }
+    }
 
     _maintenance_thread = thread([this] {
         maintenance_loop();
@@ -23,7 +80,15 @@ FileManager::FileManager(const string &base_path,
 }
 
 FileManager::~FileManager() {
-    _stop_cleanup.store(true, memory_order_relaxed);
+    if (_watcher) {
+        _directory_manager.set_directory_listener(nullptr);
+        _watcher->stop();
+    }
+    {
+        // 在锁内置位, 维护线程不会在检查条件与进入等待之间错过通知
+        lock_guard lock(_maintenance_mutex);
+        _stop_cleanup = true;
+    }
     _maintenance_cv.notify_all();
     if (_maintenance_thread.joinable()) {
         _maintenance_thread.join();
@@ -32,99 +97,262 @@ FileManager::~FileManager() {
 
 bool FileManager::create_file(const string &business_id,
                               const string &filename,
-                              const string &content) {
-    const string path = resolve_path(business_id, filename);
-    _metadata_manager.update_metadata(path);
+                              const string &content,
+                              Durability durability) {
+    auto result = write_file(WriteType::CREATE, business_id, filename, content, durability);
+    return accepted_or_result(result);
+}
 
-    auto start = chrono::high_resolution_clock::now();
-    LOGE(LOG_TAG, "start time:= %lld", start);
-    if (_use_async_writer) {
-        auto cache_ptr = &_cache;
-        enqueue_write([=] {
-            auto middle = chrono::high_resolution_clock::now();
-//            auto duration = chrono::duration_cast<chrono::milliseconds>();
-            LOGE(LOG_TAG, "middle time:= %lld", (middle - start));
-            if (_file_operator.create_file(path, content)) {
-                cache_ptr->put(path, filename);
-            }
-            auto end = chrono::high_resolution_clock::now();
-//            auto dura = chrono::duration_cast<chrono::milliseconds>(end - middle);
-            LOGE(LOG_TAG, "end time:= %lld", (end - middle));
-        });
-        return true;
+bool FileManager::read_file(const std::string &business_id, const std::string &filename,
+                            std::string &output) {
+    return read_path(resolve_path(business_id, filename), filename, output);
+}
+
+
+vector<bool> FileManager::batch_read(const vector<BatchRead> &reads, vector<std::string> &outputs) {
+    vector<string> paths;
+    paths.reserve(reads.size());
+    for (const auto& read : reads) {
+        paths.push_back(resolve_path(read.business_id, read.filename));
     }
 
-    bool success = _file_operator.create_file(path, content);
-    if (success) {
-        _cache.put(path, filename);
+    vector<size_t> order(reads.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&paths](size_t a, size_t b) {
+        return paths[a] < paths[b];
+    });
+
+    outputs.assign(reads.size(), string());
+    vector<bool> results(reads.size(), false);
+    for (size_t index : order) {
+        results[index] = read_path(paths[index], reads[index].filename, outputs[index]);
     }
-    return success;
+    return results;
 }
 
-bool FileManager::read_file(const std::string &business_id, const std::string &filename,
-                            std::string &output) {
-    const string path = resolve_path(business_id, filename);
-    _metadata_manager.update_metadata(path);
 
-    if (auto cached_name = _cache.get(path)) {
-        if (*cached_name == filename) {
-            return _file_operator.read_file(path, output);
+bool FileManager::read_path(const std::string &path, const std::string &filename, std::string &output) {
+    // 包内文件优先, 同名的普通文件可能是迁入段文件前的旧版本
+    const filesystem::path file_path(path);
+    if (auto pack = find_pack(file_path.parent_path().string())) {
+        if (pack->get(file_path.filename().string(), output)) {
+            if (FileCompressor::is_compressed(output.data(), output.size())) {
+                FileCompressor::decompress(output.data(), output.size(), output);
+            }
+            _cache.put(path, filename);
+            return true;
         }
     }
+
+    // 元数据在新鲜度窗口内 (或所在目录已监听) 时不触发 stat; 内容缓存命中且 mtime 与大小一致时直接返回
+    // 跨进程模式下其他进程的同大小改写可能不改变 mtime 精度内的取值, 不使用内容缓存
+    const uint64_t generation = _content_cache.generation(path);
+    const auto meta = _metadata_manager.update_metadata(path);
+    if (!_cross_process && read_cached_content(path, meta, output)) {
+        return true;
+    }
+
     bool success = _file_operator.read_file(path, output);
     if (success) {
+        const uint64_t stored_size = output.size();
+        // 帧结构校验失败时按原始内容返回, 恰好以魔数开头的普通文件不受影响
+        if (FileCompressor::is_compressed(output.data(), output.size())) {
+            FileCompressor::decompress(output.data(), output.size(), output);
+        }
         _cache.put(path, filename);
+        cache_content(path, output, stored_size, meta, generation);
     }
     return success;
 }
 
-bool FileManager::update_file(const std::string &business_id, const std::string &filename,
-                              const std::string &content) {
+AtomicFileOperator::MappedView FileManager::map_file(const std::string &business_id,
+                                                    const std::string &filename) {
     const string path = resolve_path(business_id, filename);
     _metadata_manager.update_metadata(path);
+    return _file_operator.map_file(path);
+}
 
-    if (_use_async_writer) {
-        enqueue_write([=] {
-            _file_operator.update_file(path, content);
+AtomicFileOperator::ReadStream FileManager::open_read_stream(const std::string &business_id,
+                                                            const std::string &filename) {
+    const string path = resolve_path(business_id, filename);
+    _metadata_manager.update_metadata(path);
+    return _file_operator.open_read_stream(path);
+}
+
+
+AtomicFileOperator::WriteStream FileManager::open_write_stream(const std::string &business_id,
+                                                              const std::string &filename) {
+    const string path = resolve_path(business_id, filename);
+    auto stream = _file_operator.open_write_stream(path);
+    if (stream) {
+        auto pack = find_pack(filesystem::path(path).parent_path().string());
+        if (pack) {
+            pack->mark_loose_files();
+        }
+        stream->set_commit_callback([this, pack](const string& committed_path, bool success) {
+            // 提交的普通文件取代包内的同名文件
+            if (success && pack) {
+                pack->remove(filesystem::path(committed_path).filename().string(), Durability::NONE);
+            }
+            finish_write(WriteType::UPDATE, committed_path, success);
         });
-        return true;
     }
+    return stream;
+}
+
 
-    return _file_operator.update_file(path, content);
+bool FileManager::update_file(const std::string &business_id, const std::string &filename,
+                              const std::string &content, Durability durability) {
+    auto result = write_file(WriteType::UPDATE, business_id, filename, content, durability);
+    return accepted_or_result(result);
 }
 
 bool FileManager::append_file(const std::string &business_id, const std::string &filename,
-                              const std::string &content) {
-    const string path = resolve_path(business_id, filename);
-    if (_use_async_writer) {
-        enqueue_write([=] {
+                              const std::string &content, Durability durability) {
+    auto result = write_file(WriteType::APPEND, business_id, filename, content, durability);
+    return accepted_or_result(result);
+}
 
-            _file_operator.append_file_safely(path, content);
-        });
-        return true;
+
+bool FileManager::delete_file(const std::string &business_id, const std::string &filename,
+                              Durability durability) {
+    auto result = write_file(WriteType::DELETE, business_id, filename, "", durability);
+    return accepted_or_result(result);
+}
+
+
+future<bool> FileManager::write_file(WriteType type,
+                                     const std::string &business_id,
+                                     const std::string &filename,
+                                     const std::string &content,
+                                     Durability durability) {
+    const string path = prepare_write(type, business_id, filename);
+
+    if (!_use_async_writer) {
+        promise<bool> result;
+        result.set_value(execute_write(type, path, content, durability));
+        return result.get_future();
     }
-    return _file_operator.append_file_safely(path, content);
+
+    init_async_write();
+    return _async_writer->enqueue_write(type, path, content, durability);
 }
 
 
-bool FileManager::delete_file(const std::string &business_id, const std::string &filename) {
-    const string path = resolve_path(business_id, filename);
-    _metadata_manager.remove_metadata(path);
-    _cache.remove(path);
+void FileManager::write_file(WriteType type,
+                             const std::string &business_id,
+                             const std::string &filename,
+                             const std::string &content,
+                             Durability durability,
+                             AsyncBatchWriter::Completion on_complete) {
+    const string path = prepare_write(type, business_id, filename);
+
+    if (!_use_async_writer) {
+        bool success = execute_write(type, path, content, durability);
+        if (on_complete) {
+            on_complete(success);
+        }
+        return;
+    }
+
+    init_async_write();
+    _async_writer->enqueue_write(type, path, content, durability, std::move(on_complete));
+}
+
+
+vector<bool> FileManager::batch_write(vector<BatchWrite> writes, Durability durability) {
+    const size_t count = writes.size();
+    auto result = submit_batch(std::move(writes), durability);
+    if (!_use_async_writer || result.wait_for(chrono::seconds(0)) == future_status::ready) {
+        return result.get();
+    }
+    // 同 accepted_or_result, 异步模式下不等待整批完成
+    return vector<bool>(count, true);
+}
+
+
+future<vector<bool>> FileManager::submit_batch(vector<BatchWrite> writes, Durability durability) {
+    vector<AsyncBatchWriter::WriteRequest> requests;
+    requests.reserve(writes.size());
+    for (auto& write : writes) {
+        requests.push_back(AsyncBatchWriter::WriteRequest{
+                write.type,
+                prepare_write(write.type, write.business_id, write.filename),
+                std::move(write.payload),
+                durability});
+    }
+
+    // 路径相同的写入保持提交顺序, 排序后相邻
+    vector<size_t> order(requests.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+        return requests[a].path < requests[b].path;
+    });
+
+    auto waiter = make_shared<promise<vector<bool>>>();
+    future<vector<bool>> result = waiter->get_future();
 
     if (_use_async_writer) {
-        enqueue_write([=] {
-            _file_operator.delete_file(path);
+        vector<AsyncBatchWriter::WriteRequest> sorted;
+        sorted.reserve(requests.size());
+        for (size_t index : order) {
+            sorted.push_back(std::move(requests[index]));
+        }
+        init_async_write();
+        _async_writer->enqueue_batch(std::move(sorted), [waiter, order](const vector<bool>& sorted_results) {
+            vector<bool> results(order.size(), false);
+            for (size_t i = 0; i < order.size(); ++i) {
+                results[order[i]] = sorted_results[i];
+            }
+            waiter->set_value(results);
         });
-        return true;
+        return result;
+    }
+
+    // 后端能批量提交 I/O 时 NONE 级别的写入同样整批提交
+    vector<bool> results(requests.size(), false);
+    if (durability == Durability::NONE && _file_operator.io_backend()->kind() == IoBackend::Kind::SYNC) {
+        for (size_t index : order) {
+            const auto& request = requests[index];
+            results[index] = execute_write(request.type, request.path, request.payload, durability);
+        }
+        waiter->set_value(results);
+        return result;
     }
 
-    return _file_operator.delete_file(path);
+    // 一次落盘提交中同一路径只能出现一次, 遇到重复路径时先提交前面的部分
+    vector<const AsyncBatchWriter::WriteRequest*> group;
+    vector<size_t> group_indexes;
+    auto commit_group = [&] {
+        vector<bool> group_results = execute_durable_batch(group);
+        for (size_t i = 0; i < group_indexes.size(); ++i) {
+            results[group_indexes[i]] = group_results[i];
+        }
+        group.clear();
+        group_indexes.clear();
+    };
+    for (size_t index : order) {
+        if (!group.empty() && group.back()->path == requests[index].path) {
+            commit_group();
+        }
+        group.push_back(&requests[index]);
+        group_indexes.push_back(index);
+    }
+    if (!group.empty()) {
+        commit_group();
+    }
+    waiter->set_value(results);
+    return result;
 }
 
 
 bool FileManager::file_exists(const std::string &business_id, const std::string &filename) {
     const string path = resolve_path(business_id, filename);
+    const filesystem::path file_path(path);
+    auto pack = find_pack(file_path.parent_path().string());
+    if (pack && pack->contains(file_path.filename().string())) {
+        return true;
+    }
     _metadata_manager.update_metadata(path);
     return _file_operator.file_exists(path);
 }
@@ -135,15 +363,101 @@ void FileManager::prefetch_directory(const std::string &business_id,
                                      const int32_t day,
                                      const bool flag,
                                      vector<string> &files) {
+    prefetch_directory(business_id, sub_str, day, flag, SIZE_MAX, [&files](vector<string>& page) {
+        files.insert(files.end(), make_move_iterator(page.begin()), make_move_iterator(page.end()));
+        return true;
+    });
+}
+
+
+bool FileManager::prefetch_directory(const std::string &business_id,
+                                     const std::string &sub_str,
+                                     const int32_t day,
+                                     const bool flag,
+                                     size_t page_size,
+                                     const PageCallback &on_page) {
     const string dir_path = _directory_manager.resolve_path(business_id, "");
 
-    list_directory(dir_path, sub_str, day, flag, files);
+    // 索引建立时已批量刷新元数据, 这里只需预热路径缓存
+    return list_directory(dir_path, sub_str, day, flag, page_size, [&](vector<string>& page) {
+        for(const auto& filename: page) {
+            _cache.put(resolve_path(business_id, filename), filename);
+        }
+        return on_page(page);
+    });
+}
+
+
+void FileManager::set_compression(const std::string &business_id, bool enabled) {
+    const string directory = _directory_manager.get_business_path(business_id);
+    unique_lock lock(_compression_mutex);
+    auto it = find(_compressed_directories.begin(), _compressed_directories.end(), directory);
+    if (enabled && it == _compressed_directories.end()) {
+        _compressed_directories.push_back(directory);
+    } else if (!enabled && it != _compressed_directories.end()) {
+        _compressed_directories.erase(it);
+    }
+}
+
+
+bool FileManager::enable_packed_storage(const std::string &business_id) {
+    // 段文件的写入位置与索引只保存在本进程内存中, 多个进程同时追加会互相覆盖
+    if (_cross_process) {
+        LOGW(LOG_TAG, "Packed storage is unavailable with cross-process locks");
+        return false;
+    }
+    const string directory = _directory_manager.get_business_path(business_id);
+    unique_lock lock(_pack_mutex);
+    auto& slot = _packed_stores[directory];
+    if (!slot) {
+        slot = PackedFileStore::open(directory, true);
+    }
+    return slot != nullptr;
+}
+
+
+IoBackend::Kind FileManager::set_io_backend(IoBackend::Kind kind) {
+    auto backend = IoBackend::create(kind);
+    const IoBackend::Kind actual = backend->kind();
+    _file_operator.set_io_backend(std::move(backend));
+    if (_use_async_writer) {
+        init_async_write();
+        _async_writer->set_batch_all_writes(actual != IoBackend::Kind::SYNC);
+    }
+    return actual;
+}
+
+
+AsyncBatchWriter::Stats FileManager::writer_stats() const {
+    if (!_async_writer) {
+        return {};
+    }
+    return _async_writer->get_stats();
+}
+
 
-    for(const auto& filename: files) {
-        const string full_path = resolve_path(business_id, filename);
-        _cache.put(full_path, filename);
-        _metadata_manager.update_metadata(full_path);
+void FileManager::set_write_queue_limit(size_t max_pending, AsyncBatchWriter::OverflowPolicy policy) {
+    if (!_use_async_writer) {
+        return;
     }
+    init_async_write();
+    _async_writer->set_queue_limit(max_pending, policy);
+}
+
+
+size_t FileManager::write_queue_depth() const {
+    if (!_async_writer) {
+        return 0;
+    }
+    return _async_writer->queue_depth();
+}
+
+
+void FileManager::flush_writes() {
+    if (!_async_writer) {
+        return;
+    }
+    _async_writer->flush();
 }
 
 
@@ -152,63 +466,493 @@ string FileManager::resolve_path(const std::string &business_id, const std::stri
 }
 
 
-void FileManager::list_directory(const std::string &path,
+bool FileManager::list_directory(const std::string &path,
                                  const std::string &sub_str,
                                  const int32_t day,
                                  const bool flag,
-                                 vector<std::string> &files) {
+                                 size_t page_size,
+                                 const PageCallback &on_page) {
     if (path.empty()) {
+        return false;
+    }
+
+    // 目录路径统一为不带结尾分隔符的形式, 与写入路径的 parent_path 一致
+    filesystem::path normalized(path);
+    if (!normalized.has_filename()) {
+        normalized = normalized.parent_path();
+    }
+    const string dir_path = normalized.string();
+
+    // 跨进程模式下索引依靠目录通知得知其他进程的变更, 监听不可用时每次重新扫描
+    if (_cross_process && !_watcher) {
+        drop_index(dir_path);
+    }
+
+    shared_ptr<DirectoryIndex> index;
+    {
+        unique_lock lock(_index_mutex);
+        auto& slot = _directory_indexes[dir_path];
+        if (!slot) {
+            slot = make_shared<DirectoryIndex>(dir_path);
+        }
+        index = slot;
+    }
+
+    page_size = max(page_size, static_cast<size_t>(1));
+    const DirectoryIndex::Filter filter(sub_str, day, flag);
+    vector<string> page;
+    bool stopped = false;
+    auto emit = [&](string name) {
+        page.push_back(std::move(name));
+        if (page.size() >= page_size) {
+            stopped = !on_page(page);
+            page.clear();
+        }
+        return !stopped;
+    };
+
+    // 包内文件先于普通文件交付; 同名的普通文件是迁入前的旧版本, 不再重复列出
+    auto pack = find_pack(dir_path);
+    if (pack) {
+        vector<string> files;
+        pack->query(filter, files);
+        for (auto& filename : files) {
+            if (!emit(std::move(filename))) {
+                return true;
+            }
+        }
+    }
+    auto packed = [&pack](const string& name) {
+        return pack && pack->contains(name);
+    };
+
+    // 需要扫描时边扫描边交付; 索引已建立 (或由其他线程建立) 时直接查询
+    bool streamed = false;
+    bool built = index->ensure_built(_metadata_manager,
+            [&](const vector<FileMetadataManager::DirectoryEntry>& chunk) {
+                streamed = true;
+                for (const auto& entry : chunk) {
+                    if (filter.accepts(entry.name, entry.metadata.last_modified) && !packed(entry.name) &&
+                        !emit(entry.name)) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+    if (stopped) {
+        return true;
+    }
+    if (!built) {
+        return false;
+    }
+
+    if (!streamed) {
+        vector<string> files;
+        index->query(filter, files);
+        for (auto& filename : files) {
+            if (!packed(filename) && !emit(std::move(filename))) {
+                return true;
+            }
+        }
+    }
+    if (!page.empty()) {
+        on_page(page);
+    }
+    return true;
+}
+
+
+shared_ptr<DirectoryIndex> FileManager::find_index(const std::string &dir_path) {
+    shared_lock lock(_index_mutex);
+    auto it = _directory_indexes.find(dir_path);
+    return it != _directory_indexes.end() ? it->second : nullptr;
+}
+
+
+void FileManager::update_index(const std::string &path, optional<filesystem::file_time_type> mtime) {
+    const filesystem::path file_path(path);
+    auto index = find_index(file_path.parent_path().string());
+    if (!index) {
         return;
     }
 
-    error_code ec;
-    auto now = filesystem::file_time_type::clock::now();
-    auto iter = filesystem::directory_iterator(path, ec);
-    if (ec) {
+    if (mtime.has_value()) {
+        index->upsert(file_path.filename().string(), *mtime);
+    } else {
+        index->remove(file_path.filename().string());
+    }
+}
+
+
+void FileManager::drop_index(const std::string &dir_path) {
+    unique_lock lock(_index_mutex);
+    if (dir_path.empty()) {
+        _directory_indexes.clear();
+    } else {
+        _directory_indexes.erase(dir_path);
+    }
+}
+
+bool FileManager::read_cached_content(const std::string &path, const FileMetadataManager::FileMetadata &meta,
+                                      std::string &output) {
+    if (!meta.exists) {
+        return false;
+    }
+
+    auto content = _content_cache.get(path, meta.last_modified, meta.file_size);
+    if (!content) {
+        return false;
+    }
+
+    output.assign(*content);
+    return true;
+}
+
+
+void FileManager::cache_content(const std::string &path, const std::string &content, uint64_t stored_size,
+                                const FileMetadataManager::FileMetadata &meta, uint64_t generation) {
+    // 以读取前的快照作为版本: 读到的大小与快照不一致说明读取前后文件被改写;
+    // 本进程的写入完成时会 invalidate, put 据 generation 拒绝; 其他进程的写入使 mtime 变化, 下次命中校验失败
+    if (_cross_process || !meta.exists || meta.file_size != stored_size) {
         return;
     }
+    _content_cache.put(path, make_shared<const string>(content), meta.last_modified, stored_size, generation);
+}
+
 
-    bool use_time_filer = (day > 0);
-    filesystem::file_time_type cutoff_time;
-    if (use_time_filer) {
-        auto duration = chrono::hours(24 * day);
-        cutoff_time = now - duration;
+bool FileManager::compression_enabled(const std::string &path) {
+    shared_lock lock(_compression_mutex);
+    for (const auto& directory : _compressed_directories) {
+        if (path.size() > directory.size() && path[directory.size()] == '/' &&
+            path.compare(0, directory.size(), directory) == 0) {
+            return true;
+        }
     }
-    bool should_filter = !sub_str.empty();
+    return false;
+}
 
-    for(const auto& entry: iter) {
-        if (entry.is_directory(ec) || ec) continue;
-        if (!entry.is_regular_file()) continue;
 
-        string filename = entry.path().filename().string();
-        auto file_time = entry.last_write_time(ec);
-        if (ec) continue;
+bool FileManager::encode_payload(WriteType type, const std::string &path, const std::string &content,
+                                 std::string &encoded) {
+    if (type == WriteType::DELETE) {
+        return false;
+    }
+    const bool enabled = compression_enabled(path);
+    if (type != WriteType::APPEND) {
+        if (enabled) {
+            encoded = FileCompressor::compress(content);
+        }
+        return enabled;
+    }
 
-        if (should_filter && filename.find(sub_str) == string::npos) {
-            continue;
+    // 追加写沿用已有文件的格式, 与当前是否开启压缩无关: 普通文件追加原始内容,
+    // 已压缩的文件追加新的帧 (压缩关闭时以不压缩的帧封装); 文件不存在或为空时按当前设置
+    // 异步模式下同一路径的写入在同一线程上顺序执行, 检查与追加之间文件格式不会改变
+    optional<bool> framed;
+    const filesystem::path file_path(path);
+    auto pack = find_pack(file_path.parent_path().string());
+    string existing;
+    if (pack && pack->get(file_path.filename().string(), existing)) {
+        if (!existing.empty()) {
+            framed = FileCompressor::is_framed(existing.data(), existing.size());
+        }
+    } else {
+        framed = probe_format(path);
+    }
+
+    if (!framed.value_or(enabled)) {
+        return false;
+    }
+    encoded = enabled ? FileCompressor::compress(content) : FileCompressor::store(content);
+    return true;
+}
+
+
+optional<bool> FileManager::probe_format(const std::string &path) {
+    // 普通文件追加原始内容后仍是普通文件, 被本进程替换或删除时 finish_write 会清除记录
+    if (!_cross_process) {
+        lock_guard lock(_format_mutex);
+        auto it = _format_probes.find(path);
+        if (it != _format_probes.end() && !it->second.framed) {
+            return false;
+        }
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullopt;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size == 0) {
+        close(fd);
+        return nullopt;
+    }
+
+    // 同一文件 (inode 不变) 只需校验上次之后追加的帧
+    const auto size = static_cast<uint64_t>(sb.st_size);
+    uint64_t offset = 0;
+    {
+        lock_guard lock(_format_mutex);
+        auto it = _format_probes.find(path);
+        if (it != _format_probes.end() && it->second.framed && it->second.inode == sb.st_ino &&
+            it->second.verified <= size) {
+            offset = it->second.verified;
+        }
+    }
+
+    bool framed = true;
+    char header[FileCompressor::FRAME_HEADER_SIZE];
+    while (offset < size) {
+        if (size - offset < sizeof(header) ||
+            pread(fd, header, sizeof(header), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(header))) {
+            framed = false;
+            break;
+        }
+        const uint64_t length = FileCompressor::frame_length(header, size - offset - sizeof(header));
+        if (length == 0) {
+            framed = false;
+            break;
         }
+        offset += length;
+    }
+    close(fd);
+
+    lock_guard lock(_format_mutex);
+    if (_format_probes.size() >= MAX_FORMAT_PROBES) {
+        _format_probes.clear();
+    }
+    _format_probes[path] = FormatProbe{framed, sb.st_ino, framed ? size : 0};
+    return framed;
+}
+
+
+void FileManager::forget_format(const std::string &path, bool plain_only) {
+    lock_guard lock(_format_mutex);
+    auto it = _format_probes.find(path);
+    if (it != _format_probes.end() && (!plain_only || !it->second.framed)) {
+        _format_probes.erase(it);
+    }
+}
 
-        if (use_time_filer) {
-            if (flag) {
-                if (file_time < cutoff_time) continue;
-            } else {
-                if (file_time >= cutoff_time) continue;
+
+shared_ptr<PackedFileStore> FileManager::find_pack(const std::string &dir_path) {
+    {
+        shared_lock lock(_pack_mutex);
+        auto it = _packed_stores.find(dir_path);
+        if (it != _packed_stores.end()) {
+            return it->second;
+        }
+    }
+
+    // 每个目录只探测一次, 未开启的目录同样记录下来; 跨进程模式下不打开已有的段文件
+    unique_lock lock(_pack_mutex);
+    auto [it, inserted] = _packed_stores.try_emplace(dir_path);
+    if (inserted && !_cross_process) {
+        it->second = PackedFileStore::open(dir_path, false);
+    } else if (inserted) {
+        error_code ec;
+        const auto segment = filesystem::path(dir_path) / PackedFileStore::PACK_DIRECTORY /
+                             PackedFileStore::SEGMENT_FILENAME;
+        if (filesystem::exists(segment, ec)) {
+            LOGW(LOG_TAG, "Ignoring packed segment in %s under cross-process locks", dir_path.c_str());
+        }
+    }
+    return it->second;
+}
+
+
+optional<bool> FileManager::execute_packed_write(PackedFileStore &pack, WriteType type, const std::string &path,
+                                                 const std::string &content, Durability durability) {
+    const string name = filesystem::path(path).filename().string();
+    switch (type) {
+        case WriteType::CREATE:
+        case WriteType::UPDATE:
+            if (content.size() > PackedFileStore::MAX_VALUE_SIZE) {
+                pack.mark_loose_files();
+                return nullopt;
+            }
+            if (!pack.put(name, content, durability)) {
+                return false;
             }
+            // 段文件中的记录优先, 旧文件删除失败不影响结果
+            if (pack.has_loose_files()) {
+                _file_operator.delete_file(path, Durability::NONE);
+            }
+            return true;
+        case WriteType::APPEND:
+            // 包外已有的普通文件继续原地追加
+            if (!pack.contains(name) && pack.has_loose_files() && _file_operator.file_exists(path)) {
+                return nullopt;
+            }
+            return pack.append(name, content, durability, [&](const string& combined) {
+                return _file_operator.update_file(path, combined, durability);
+            });
+        case WriteType::DELETE: {
+            bool removed = pack.remove(name, durability);
+            if (pack.has_loose_files()) {
+                removed = _file_operator.delete_file(path, durability) || removed;
+            }
+            return removed;
         }
-        files.push_back(filename);
     }
+    return nullopt;
 }
 
-void FileManager::enqueue_write(function<void()> task) {
-    if (!_async_writer) {
-        init_async_write();
+
+string FileManager::prepare_write(WriteType type, const std::string &business_id,
+                                 const std::string &filename) {
+    const string path = resolve_path(business_id, filename);
+
+    switch (type) {
+        case WriteType::CREATE:
+        case WriteType::UPDATE:
+            _metadata_manager.update_metadata(path);
+            break;
+        case WriteType::APPEND:
+            break;
+        case WriteType::DELETE:
+            _metadata_manager.remove_metadata(path);
+            _cache.remove(path);
+            break;
+    }
+    _content_cache.invalidate(path);
+    return path;
+}
+
+
+bool FileManager::accepted_or_result(future<bool> &result) {
+    if (!_use_async_writer) {
+        return result.get();
+    }
+    // 异步模式下不等待写入完成; 已就绪 (入队被拒绝或已执行完) 时返回真实结果
+    if (result.wait_for(chrono::seconds(0)) == future_status::ready) {
+        return result.get();
+    }
+    return true;
+}
+
+
+bool FileManager::execute_write(WriteType type, const std::string &path, const std::string &raw_content,
+                                Durability durability) {
+    const filesystem::path file_path(path);
+    // 内部文件名保留给临时文件与意图日志, 业务写入一律拒绝
+    if (AtomicFileOperator::is_internal_name(file_path.filename().string())) {
+        finish_write(type, path, false);
+        return false;
     }
-    _async_writer->enqueue(std::move(task));
+
+    string encoded;
+    const string& content = encode_payload(type, path, raw_content, encoded) ? encoded : raw_content;
+
+    auto pack = find_pack(file_path.parent_path().string());
+    if (pack) {
+        auto result = execute_packed_write(*pack, type, path, content, durability);
+        if (result.has_value()) {
+            // 追加超出上限时已迁出为普通文件
+            const bool packed = type != WriteType::DELETE && pack->contains(file_path.filename().string());
+            finish_write(type, path, *result, packed);
+            return *result;
+        }
+    }
+
+    bool success = false;
+    switch (type) {
+        case WriteType::CREATE:
+            success = _file_operator.create_file(path, content, durability);
+            break;
+        case WriteType::UPDATE:
+            success = _file_operator.update_file(path, content, durability);
+            break;
+        case WriteType::APPEND:
+            success = _file_operator.append_file_safely(path, content, durability);
+            break;
+        case WriteType::DELETE:
+            success = _file_operator.delete_file(path, durability);
+            break;
+    }
+    // 超出上限的文件写为普通文件后, 删除包内的旧版本
+    if (success && pack && type != WriteType::APPEND) {
+        pack->remove(file_path.filename().string(), durability);
+    }
+
+    finish_write(type, path, success);
+    return success;
 }
 
+
+void FileManager::finish_write(WriteType type, const std::string &path, bool success, bool packed) {
+    if (type != WriteType::APPEND) {
+        forget_format(path, false);
+    }
+    if (success) {
+        if (type == WriteType::CREATE) {
+            _cache.put(path, filesystem::path(path).filename().string());
+        }
+        // 以完成时刻近似 mtime, 按天划分的年龄窗口不受影响, 也省去一次 stat
+        // 包内文件由段文件的索引列出, 目录索引中只保留普通文件
+        if (type == WriteType::DELETE || packed) {
+            update_index(path, nullopt);
+        } else {
+            update_index(path, FileMetadataManager::current_file_time());
+        }
+    }
+
+    // 写入完成后再次失效, 覆盖写入执行期间被读取并缓存的旧内容;
+    // 元数据跳过新鲜度窗口, 下次访问时重新 stat
+    _metadata_manager.mark_stale(path);
+    _content_cache.invalidate(path);
+}
+
+
+vector<bool> FileManager::execute_durable_batch(
+        const vector<const AsyncBatchWriter::WriteRequest *> &requests) {
+    // 按路径顺序加锁, 同一目录的写入相邻
+    vector<size_t> order(requests.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+        return requests[a]->path < requests[b]->path;
+    });
+
+    // 整个批次共用一次数据落盘和每个父目录一次 fsync
+    // 打包目录中的写入逐个追加到段文件, 每次追加只需一次 fdatasync
+    DurableWriteBatch batch(_file_operator);
+    vector<size_t> batched;
+    vector<bool> results(requests.size(), false);
+    string encoded;
+    for (size_t index : order) {
+        const auto* request = requests[index];
+        if (find_pack(filesystem::path(request->path).parent_path().string())) {
+            results[index] = execute_write(request->type, request->path, request->payload, request->durability);
+            continue;
+        }
+        const string& payload = encode_payload(request->type, request->path, request->payload, encoded)
+                                ? encoded : request->payload;
+        batch.add(request->type, request->path, payload, request->durability);
+        batched.push_back(index);
+    }
+    vector<bool> committed = batch.commit();
+
+    for (size_t i = 0; i < batched.size(); ++i) {
+        results[batched[i]] = committed[i];
+    }
+    for (size_t index : batched) {
+        finish_write(requests[index]->type, requests[index]->path, results[index]);
+    }
+    return results;
+}
+
+
 void FileManager::init_async_write() {
     call_once(_async_init_flag, [this] {
-        _async_writer = make_unique<AsyncBatchWriter>();
+        _async_writer = make_unique<AsyncBatchWriter>(_writer_threads);
+        _async_writer->set_journal(_journal.get());
+        _async_writer->set_write_handler([this](const AsyncBatchWriter::WriteRequest& request) {
+            return execute_write(request.type, request.path, request.payload, request.durability);
+        });
+        _async_writer->set_durable_handler(
+                [this](const vector<const AsyncBatchWriter::WriteRequest*>& requests) {
+                    return execute_durable_batch(requests);
+                });
         _async_writer->set_batch_params(10, 100,
                                         chrono::milliseconds(50),
                                         chrono::milliseconds(200));
@@ -216,29 +960,167 @@ void FileManager::init_async_write() {
 }
 
 
-void FileManager::maintenance_loop() {
-    while(!_stop_cleanup.load()) {
-        unique_lock lock(_maintenance_mutex);
-        _maintenance_cv.wait_for(lock, chrono::minutes(5));
+void FileManager::replay_journal(int journal_fd) {
+    auto records = WriteAheadJournal::recover(journal_fd);
+    if (records.empty()) {
+        return;
+    }
+
+    LOGI(LOG_TAG, "Replaying %zu pending writes from journal", records.size());
+    for (const auto& record : records) {
+        _content_cache.invalidate(record.path);
+        if (!execute_write(record.type, record.path, record.payload, record.durability)) {
+            LOGW(LOG_TAG, "Failed to replay write to %s", record.path.c_str());
+        }
+    }
+}
+
 
-        if (_stop_cleanup.load()) {
+void FileManager::on_directory_event(DirectoryWatcher::Event event, const std::string &path) {
+    // 临时文件与意图日志不可读也不可列举, 其变更只会把无用的条目带进索引与缓存
+    if ((event == DirectoryWatcher::Event::MODIFIED || event == DirectoryWatcher::Event::REMOVED) &&
+        AtomicFileOperator::is_internal_name(filesystem::path(path).filename().string())) {
+        return;
+    }
+    switch (event) {
+        case DirectoryWatcher::Event::MODIFIED: {
+            // 帧格式的记录以 inode 与大小自行校验, 本进程的追加不会使其失效
+            forget_format(path, true);
+            _metadata_manager.mark_stale(path);
+            _content_cache.invalidate(path);
+            // 在监听线程上 stat, 不占用查询路径
+            FileMetadataManager::FileMetadata meta(path);
+            update_index(path, meta.exists ? optional(meta.last_modified) : nullopt);
             break;
         }
-        perform_maintenance();
+        case DirectoryWatcher::Event::REMOVED:
+            forget_format(path, false);
+            _metadata_manager.mark_stale(path);
+            _content_cache.invalidate(path);
+            _cache.remove(path);
+            update_index(path, nullopt);
+            break;
+        case DirectoryWatcher::Event::UNWATCHED:
+            _metadata_manager.unwatch_directory(path);
+            drop_index(path);
+            break;
+        case DirectoryWatcher::Event::OVERFLOW:
+            // 无法得知丢失了哪些事件, 全部重新校验, 索引在下次查询时重建
+            _metadata_manager.mark_all_stale();
+            _content_cache.clear();
+            drop_index("");
+            break;
     }
 }
 
 
-void FileManager::perform_maintenance() {
+void FileManager::on_trim_memory(int level) {
+    MemoryPressure pressure = MemoryPressure::NORMAL;
+    if (level >= TRIM_MEMORY_COMPLETE || level == TRIM_MEMORY_RUNNING_CRITICAL) {
+        pressure = MemoryPressure::CRITICAL;
+    } else if (level >= TRIM_MEMORY_BACKGROUND || level == TRIM_MEMORY_RUNNING_LOW) {
+        pressure = MemoryPressure::MODERATE;
+    }
+
+    {
+        lock_guard lock(_maintenance_mutex);
+        _memory_pressure = max(_memory_pressure, pressure);
+        _maintenance_requested = true;
+    }
+    _maintenance_cv.notify_one();
+}
+
+
+void FileManager::maintenance_loop() {
+    unique_lock lock(_maintenance_mutex);
+    while (true) {
+        _maintenance_cv.wait_for(lock, _maintenance_interval, [this] {
+            return _stop_cleanup || _maintenance_requested;
+        });
+        if (_stop_cleanup) {
+            break;
+        }
+        _maintenance_requested = false;
+        const MemoryPressure pressure = _memory_pressure;
+
+        lock.unlock();
+        const bool trimmed = perform_maintenance(pressure);
+        lock.lock();
+
+        // 内存压力每次维护后降一级; 仍需裁剪时缩短间隔, 空闲时逐步放宽到上限
+        if (_memory_pressure == pressure && pressure != MemoryPressure::NORMAL) {
+            _memory_pressure = static_cast<MemoryPressure>(static_cast<int>(pressure) - 1);
+        }
+        if (pressure == MemoryPressure::CRITICAL) {
+            _maintenance_interval = MIN_MAINTENANCE_INTERVAL;
+        } else if (trimmed || pressure == MemoryPressure::MODERATE) {
+            _maintenance_interval = max(MIN_MAINTENANCE_INTERVAL, _maintenance_interval / 2);
+        } else {
+            _maintenance_interval = min(MAX_MAINTENANCE_INTERVAL, _maintenance_interval * 2);
+        }
+    }
+}
+
+
+bool FileManager::perform_maintenance(MemoryPressure pressure) {
     _lock_manager.cleanup_unused();
     _metadata_manager.cleanup_old_entries();
 
-    const size_t cache_capacity = _cache.capacity();
-    const size_t cache_size = _cache.size();
+    // 有内存压力时无论占用多少都裁剪到更低的目标
+    const bool forced = pressure != MemoryPressure::NORMAL;
+    const double target = pressure == MemoryPressure::CRITICAL ? 0.25
+                        : pressure == MemoryPressure::MODERATE ? 0.5
+                        : CACHE_TRIM_TARGET;
+    size_t trimmed = 0;
+    auto trim_above_high_water = [&](size_t used, size_t capacity, const function<size_t(size_t)>& trim) {
+        if (forced || used > capacity * CACHE_HIGH_WATER) {
+            trimmed += trim(static_cast<size_t>(capacity * target));
+        }
+    };
 
-    if (cache_size > cache_capacity * 0.8) {
-        std::call_once(_cache_cleanup_flag, [this] {
-            _maintenance_cv.notify_one();
+    trim_above_high_water(_cache.size(), _cache.capacity(), [this](size_t target_size) {
+        return _cache.trim(target_size);
+    });
+    trim_above_high_water(_metadata_manager.size(), _metadata_manager.max_entries(), [this](size_t target_size) {
+        return _metadata_manager.trim(target_size);
+    });
+    if (pressure == MemoryPressure::CRITICAL) {
+        trimmed += _content_cache.byte_size();
+        _content_cache.clear();
+    } else {
+        trim_above_high_water(_content_cache.byte_size(), _content_cache.byte_budget(), [this](size_t target_bytes) {
+            return _content_cache.trim(target_bytes);
         });
     }
-}
\ No newline at end of file
+
+    vector<shared_ptr<PackedFileStore>> packs;
+    {
+        shared_lock lock(_pack_mutex);
+        for (const auto& [dir_path, pack] : _packed_stores) {
+            if (pack) {
+                packs.push_back(pack);
+            }
+        }
+    }
+    for (const auto& pack : packs) {
+        pack->compact_if_needed();
+    }
+
+    const auto now = chrono::steady_clock::now();
+    if (_last_sweep == chrono::steady_clock::time_point{} || now - _last_sweep >= STALE_FILE_SWEEP_INTERVAL) {
+        _last_sweep = now;
+        sweep_stale_files();
+    }
+    return trimmed > 0;
+}
+
+
+void FileManager::sweep_stale_files() {
+    size_t cleaned = 0;
+    for (const auto& dir_path : _directory_manager.business_paths()) {
+        cleaned += _file_operator.cleanup_stale_files(dir_path, STALE_FILE_MIN_AGE);
+    }
+    if (cleaned > 0) {
+        LOGI(LOG_TAG, "Cleaned up %zu stale temporary files", cleaned);
+    }
+}
@@ -8,9 +8,15 @@
 #include "BusinessDirectoryManager.h"
 #include "FileLockManager.h"
 #include "AtomicFileOperator.h"
-#include "ConcurrentLRUCache.h"
+#include "ShardedLRUCache.h"
 #include "FileMetadataManager.h"
+#include "FileContentCache.h"
 #include "AsyncBatchWriter.h"
+#include "WriteAheadJournal.h"
+#include "DirectoryWatcher.h"
+#include "DirectoryIndex.h"
+#include "FileCompressor.h"
+#include "PackedFileStore.h"
 #include <atomic>
 #include <thread>
 #include <memory>
@@ -19,7 +25,10 @@
 #include <filesystem>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <shared_mutex>
 #include <system_error>
+#include <future>
 #include "utils/log_utils.h"
 
 using namespace std;
@@ -27,30 +36,99 @@ using namespace std;
 class FileManager {
 
 public:
+    static constexpr size_t DEFAULT_CONTENT_CACHE_BYTES = 8 * 1024 * 1024;
+    static constexpr size_t DEFAULT_PAGE_SIZE = 256;
+
+    // 返回 false 停止交付剩余结果
+    using PageCallback = function<bool(vector<string>& page)>;
+
+    struct BatchRead {
+        string business_id;
+        string filename;
+    };
+
+    struct BatchWrite {
+        WriteType type;
+        string business_id;
+        string filename;
+        string payload;
+    };
+
+    // cross_process_locks: 文件锁对其他进程同样生效; 开启后不使用内容缓存, 元数据每次访问重新 stat,
+    // 自动监听业务目录维护目录索引, 不能开启打包存储
     FileManager(const string& base_path,
                 size_t cache_capacity = 1000,
-                bool use_async_writer = true);
+                bool use_async_writer = true,
+                size_t content_cache_bytes = DEFAULT_CONTENT_CACHE_BYTES,
+                size_t writer_threads = 1,
+                size_t journal_bytes = 0,
+                bool watch_directories = false,
+                bool cross_process_locks = false);
 
     ~FileManager();
 
+    // 以 AtomicFileOperator::INTERNAL_PREFIX (".fm-") 开头的文件名保留给内部临时文件, 各写入接口返回 false
+    // 异步模式下 create/update/append/delete 不等待写入执行, 返回 true 只表示已入队; 需要执行结果时使用 write_file
     bool create_file(const string& business_id,
                      const string& filename,
-                     const string& content);
+                     const string& content,
+                     Durability durability = Durability::NONE);
 
     bool read_file(const string& business_id,
                    const string& filename,
                    string& output);
 
+    AtomicFileOperator::MappedView map_file(const string& business_id,
+                                            const string& filename);
+
+    // 分块读取, 流存活期间持有文件读锁, 用完应尽快释放
+    AtomicFileOperator::ReadStream open_read_stream(const string& business_id,
+                                                    const string& filename);
+
+    // 分块写入, commit 时原子替换目标文件并维护缓存与目录索引; 流不能晚于 FileManager 析构
+    // 不经过异步写入队列, 与此前提交但尚未执行的异步写入之间不保证先后
+    AtomicFileOperator::WriteStream open_write_stream(const string& business_id,
+                                                      const string& filename);
+
     bool update_file(const string& business_id,
                      const string& filename,
-                     const string& content);
+                     const string& content,
+                     Durability durability = Durability::NONE);
 
     bool append_file(const string& business_id,
                      const string& filename,
-                     const string& content);
+                     const string& content,
+                     Durability durability = Durability::NONE);
 
     bool delete_file(const string& business_id,
-                     const string& filename);
+                     const string& filename,
+                     Durability durability = Durability::NONE);
+
+    // 提交写入, 返回的 future 在写入达到 durability 指定的持久化级别后就绪; 同步模式下返回时已就绪
+    future<bool> write_file(WriteType type,
+                            const string& business_id,
+                            const string& filename,
+                            const string& content,
+                            Durability durability);
+
+    // 回调形式, 异步模式下回调在写入线程上执行, 队满被拒绝时在调用线程上执行
+    void write_file(WriteType type,
+                    const string& business_id,
+                    const string& filename,
+                    const string& content,
+                    Durability durability,
+                    AsyncBatchWriter::Completion on_complete);
+
+    // 按路径排序后依次读取, 同一目录的文件相邻访问; 结果与 outputs 按 reads 的顺序给出
+    vector<bool> batch_read(const vector<BatchRead>& reads, vector<string>& outputs);
+
+    // 批量写入, 异步模式下整批一次提交给写入器, 按路径分派到各写入线程, 整批不是原子的;
+    // 结果语义同 create_file 等单个写入接口, 异步模式下需要每个写入的执行结果时使用 submit_batch
+    vector<bool> batch_write(vector<BatchWrite> writes, Durability durability = Durability::NONE);
+
+    // 返回的 future 在整批写入完成后就绪, 结果按 writes 的顺序给出
+    // 写入按路径排序: 同一目录相邻, 加锁顺序固定; 同一路径的多次写入保持提交顺序
+    future<vector<bool>> submit_batch(vector<BatchWrite> writes, Durability durability);
 
     bool file_exists(const string& business_id,
                      const string& filename);
@@ -61,39 +139,182 @@ public:
                             const bool flag,
                             vector<string> &files);
 
+    // 分页交付结果, on_page 在调用线程上执行; 索引尚未建立时扫描完成第一块即可交付第一页
+    // 提前停止时本次扫描不会建立索引; 目录无法读取时返回 false
+    bool prefetch_directory(const string& business_id,
+                            const string& sub_str,
+                            const int32_t day,
+                            const bool flag,
+                            size_t page_size,
+                            const PageCallback& on_page);
+
+    // 开启后该业务目录的 create/update/append 以压缩格式写入, 压缩在写入线程上执行
+    // 读取时按内容自动识别, 关闭后已压缩的文件仍可正常读取; 追加写总是沿用已有文件的格式
+    // mapFile 与读写流访问的是磁盘上的原始字节
+    void set_compression(const string& business_id, bool enabled);
+
+    // 开启后该业务目录中不超过 PackedFileStore::MAX_VALUE_SIZE 的文件追加写入同一个段文件, 不再各占一个 inode
+    // 开启后不可关闭, 之后的实例按磁盘上的段文件自动识别; 已有的普通文件照常读写, 被覆盖时迁入段文件
+    // 包内文件不支持 map_file 与读取流; 段文件只由本进程访问, 跨进程模式下返回 false, 已有的段文件也不会打开
+    bool enable_packed_storage(const string& business_id);
+
+    // 切换批量写入的 I/O 后端, 返回实际生效的后端; io_uring 不可用时回退到同步实现
+    // io_uring 后端下异步写入器的每个批次 (含 NONE 级别的写入) 在一次提交中完成打开, 写入, 落盘与 rename
+    IoBackend::Kind set_io_backend(IoBackend::Kind kind);
+
+    AsyncBatchWriter::Stats writer_stats() const;
+
+    // 异步写入队列上限, 队满时按 policy 处理新的写入
+    void set_write_queue_limit(size_t max_pending, AsyncBatchWriter::OverflowPolicy policy);
+
+    size_t write_queue_depth() const;
+
+    // 等待此前提交的异步写入全部执行完成
+    void flush_writes();
+
+    // level 取 ComponentCallbacks2.onTrimMemory 的值; 立即维护一次, 并在压力消退前缩短维护间隔
+    void on_trim_memory(int level);
+
 private:
+    // 对应 ComponentCallbacks2 的 TRIM_MEMORY_* 常量
+    static constexpr int TRIM_MEMORY_RUNNING_LOW = 10;
+    static constexpr int TRIM_MEMORY_RUNNING_CRITICAL = 15;
+    static constexpr int TRIM_MEMORY_BACKGROUND = 40;
+    static constexpr int TRIM_MEMORY_COMPLETE = 80;
+
+    enum class MemoryPressure {
+        NORMAL = 0,
+        MODERATE = 1,   // 缓存裁剪到一半
+        CRITICAL = 2,   // 缓存裁剪到四分之一, 清空内容缓存
+    };
+
+    static constexpr chrono::seconds MIN_MAINTENANCE_INTERVAL{30};
+    static constexpr chrono::seconds MAX_MAINTENANCE_INTERVAL{300};
+    static constexpr chrono::seconds STALE_FILE_SWEEP_INTERVAL{3600};
+    static constexpr chrono::seconds STALE_FILE_MIN_AGE{60};
+    // 无内存压力时, 占用超过高水位才裁剪到目标比例
+    static constexpr double CACHE_HIGH_WATER = 0.9;
+    static constexpr double CACHE_TRIM_TARGET = 0.7;
+
     string resolve_path(const string& business_id,
                         const string& filename);
 
 
-    void list_directory(const string& path,
+    bool list_directory(const string& path,
                         const string& sub_str,
                         const int32_t day,
                         const bool flag,
-                        vector<string>& files);
+                        size_t page_size,
+                        const PageCallback& on_page);
+
+    shared_ptr<DirectoryIndex> find_index(const string& dir_path);
+
+    // 写入完成或收到变更通知后维护所在目录的索引; mtime 为空表示文件已不存在
+    void update_index(const string& path, optional<filesystem::file_time_type> mtime);
+
+    // dir_path 为空时丢弃全部索引
+    void drop_index(const string& dir_path);
+
+    bool read_path(const string& path, const string& filename, string& output);
+
+    // meta 为本次读取刷新得到的元数据
+    bool read_cached_content(const string& path, const FileMetadataManager::FileMetadata& meta, string& output);
+
+    // stored_size 为读取到的磁盘文件大小; meta 与 generation 均在读取磁盘之前取得
+    void cache_content(const string& path, const string& content, uint64_t stored_size,
+                       const FileMetadataManager::FileMetadata& meta, uint64_t generation);
+
+    bool compression_enabled(const string& path);
 
-    void enqueue_write(function<void()> task);
+    // 需要压缩时把编码结果写入 encoded 并返回 true, 否则应直接写入 content
+    bool encode_payload(WriteType type, const string& path, const string& content, string& encoded);
+
+    // 磁盘上已有文件的格式: 不存在或为空返回空, 否则返回是否整个文件都是完整的帧
+    optional<bool> probe_format(const string& path);
+
+    // plain_only 为 true 时只清除普通文件的记录
+    void forget_format(const string& path, bool plain_only);
+
+    // 返回目录的打包存储, 未开启时返回 nullptr; 首次访问某个目录时探测磁盘上的段文件
+    shared_ptr<PackedFileStore> find_pack(const string& dir_path);
+
+    // 小文件写入段文件; 返回空表示应按普通文件写入
+    optional<bool> execute_packed_write(PackedFileStore& pack, WriteType type, const string& path,
+                                        const string& content, Durability durability);
+
+    string prepare_write(WriteType type, const string& business_id, const string& filename);
+
+    bool accepted_or_result(future<bool>& result);
+
+    bool execute_write(WriteType type, const string& path, const string& content,
+                       Durability durability);
+
+    // 写入执行后统一维护路径缓存, 目录索引, 元数据与内容缓存; packed 表示文件现位于段文件中
+    void finish_write(WriteType type, const string& path, bool success, bool packed = false);
+
+    // 同一路径在 requests 中只能出现一次; 按路径顺序加锁, 并发提交的批次之间不会死锁
+    vector<bool> execute_durable_batch(const vector<const AsyncBatchWriter::WriteRequest*>& requests);
 
     void init_async_write();
 
+    // journal_fd 由 WriteAheadJournal::acquire 取得
+    void replay_journal(int journal_fd);
+
+    void on_directory_event(DirectoryWatcher::Event event, const string& path);
+
     void maintenance_loop();
 
-    void perform_maintenance();
+    // 返回本次是否需要裁剪缓存, 用于调整下次维护的间隔
+    bool perform_maintenance(MemoryPressure pressure);
+
+    void sweep_stale_files();
 
     BusinessDirectoryManager _directory_manager;
     FileLockManager _lock_manager;
     AtomicFileOperator _file_operator;
-    ConcurrentLRUCache<string, string> _cache;
+    ShardedLRUCache<string, string> _cache;
+    FileContentCache _content_cache;
     FileMetadataManager _metadata_manager;
+    // 业务目录路径 -> 目录索引, 首次 prefetch_directory 时建立
+    unordered_map<string, shared_ptr<DirectoryIndex>> _directory_indexes;
+    shared_mutex _index_mutex;
+    // 开启压缩的业务目录路径
+    vector<string> _compressed_directories;
+    shared_mutex _compression_mutex;
+    // 追加写入前探测到的文件格式; framed 时 verified 为已校验的完整帧前缀长度
+    struct FormatProbe {
+        bool framed;
+        ino_t inode;
+        uint64_t verified;
+    };
+    static constexpr size_t MAX_FORMAT_PROBES = 4096;
+    unordered_map<string, FormatProbe> _format_probes;
+    mutex _format_mutex;
+    // 业务目录路径 -> 打包存储, 未开启的目录记录为 nullptr
+    unordered_map<string, shared_ptr<PackedFileStore>> _packed_stores;
+    shared_mutex _pack_mutex;
+    // 日志需晚于写入器析构, 写入器退出前执行剩余请求时仍会释放日志记录
+    unique_ptr<WriteAheadJournal> _journal;
     unique_ptr<AsyncBatchWriter> _async_writer;
     once_flag _async_init_flag;
-    once_flag _cache_cleanup_flag;
     bool _use_async_writer;
+    size_t _writer_threads;
+    // 跨进程模式: 不使用内容缓存, 元数据每次访问重新 stat, 不能开启打包存储
+    bool _cross_process;
+    // 最先析构, 停止回调后才释放它会访问的缓存
+    unique_ptr<DirectoryWatcher> _watcher;
 
     thread _maintenance_thread;
     mutex _maintenance_mutex;
     condition_variable _maintenance_cv;
-    atomic<bool> _stop_cleanup;
+    // 以下由 _maintenance_mutex 保护
+    bool _stop_cleanup = false;
+    bool _maintenance_requested = false;
+    MemoryPressure _memory_pressure = MemoryPressure::NORMAL;
+    // 首次维护较早执行, 尽快清理上次进程崩溃的残留文件
+    chrono::seconds _maintenance_interval = MIN_MAINTENANCE_INTERVAL;
+    // 只在维护线程上访问
+    chrono::steady_clock::time_point _last_sweep{};
 
 };
 
@@ -3,6 +3,8 @@
 //
 
 #include "FileMetadataManager.h"
+#include "DirectoryScanner.h"
+#include <ctime>
 
 
 FileMetadataManager::FileMetadata::FileMetadata(const std::string &path) {
@@ -10,39 +12,37 @@ FileMetadataManager::FileMetadata::FileMetadata(const std::string &path) {
 }
 
 
-void FileMetadataManager::FileMetadata::refresh(const std::string &path) {
-    error_code ec;
+// 与 libc++ 的 file_time_type 表示一致: 自 Unix 纪元起的时长
+static filesystem::file_time_type to_file_time(const struct timespec& ts) {
+    auto since_epoch = chrono::seconds(ts.tv_sec) + chrono::nanoseconds(ts.tv_nsec);
+    return filesystem::file_time_type(
+            chrono::duration_cast<filesystem::file_time_type::duration>(since_epoch));
+}
 
-    exists = filesystem::exists(path, ec);
-    if (!exists || ec) {
-        return;
-    }
 
-    auto status = filesystem::status(path, ec);
-    if (ec) {
-        exists = false;
-        return;
-    }
+void FileMetadataManager::FileMetadata::refresh(const std::string &path) {
+    refresh_at(AT_FDCWD, path.c_str());
+}
 
-    if (!filesystem::is_regular_file(status)) {
-        exists = false;
-        return;
-    }
 
-    file_size = filesystem::file_size(path, ec);
-    if (ec) {
+void FileMetadataManager::FileMetadata::refresh_at(int dir_fd, const char *name) {
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
         exists = false;
         file_size = 0;
+        refreshed_at = chrono::steady_clock::now();
         return;
     }
+    assign(st);
+}
 
-    last_modified = filesystem::last_write_time(path, ec);
-    if (ec) {
-        exists = false;
-        return;
-    }
 
+void FileMetadataManager::FileMetadata::assign(const struct stat &st) {
+    exists = true;
+    file_size = static_cast<uint64_t>(st.st_size);
+    last_modified = to_file_time(st.st_mtim);
     last_access = filesystem::file_time_type::clock::now();
+    refreshed_at = chrono::steady_clock::now();
 }
 
 
@@ -51,36 +51,24 @@ bool FileMetadataManager::FileMetadata::is_outdated(const std::string &path) con
         return false;
     }
 
-    error_code ec;
-    auto current_mod_time = filesystem::last_write_time(path, ec);
-    return ec || current_mod_time != last_modified;
+    struct stat st;
+    return stat(path.c_str(), &st) != 0 || to_file_time(st.st_mtim) != last_modified;
 }
 
-void FileMetadataManager::update_metadata(const std::string &path) {
-    unique_lock lock(_mutex);
 
-    auto it = _metadata_map.find(path);
-    if (it != _metadata_map.end()) {
-        it->second.refresh(path);
-    } else {
-        _metadata_map.emplace(path, FileMetadata(path));
-    }
+FileMetadataManager::FileMetadataManager(size_t max_entries, chrono::milliseconds freshness)
+        : _max_entries(max_entries > 0 ? max_entries : 1), _freshness(freshness) {}
+
 
-    update_access_order(path);
+FileMetadataManager::FileMetadata FileMetadataManager::update_metadata(const std::string &path) {
+    unique_lock lock(_mutex);
+    return touch_locked(path, true).metadata;
 }
 
 
 const FileMetadataManager::FileMetadata &FileMetadataManager::get_metadata(const std::string &path) {
     unique_lock lock(_mutex);
-    
-    auto it = _metadata_map.find(path);
-    if (it != _metadata_map.end()) {
-        return it->second;
-    }
-    
-    auto [new_it, _] = _metadata_map.emplace(path, FileMetadata(path));
-    update_access_order(path);
-    return new_it->second;
+    return touch_locked(path, false).metadata;
 }
 
 
@@ -88,8 +76,8 @@ optional<FileMetadataManager::FileMetadata> FileMetadataManager::try_get_metadat
     shared_lock lock(_mutex);
     
     auto it = _metadata_map.find(path);
-    if (it != _metadata_map.end()) {
-        return it->second;
+    if (it != _metadata_map.end() && !it->second.stale) {
+        return it->second.metadata;
     }
     return nullopt;
 }
@@ -97,29 +85,111 @@ optional<FileMetadataManager::FileMetadata> FileMetadataManager::try_get_metadat
 
 void FileMetadataManager::remove_metadata(const std::string &path) {
     unique_lock lock(_mutex);
-    _metadata_map.erase(path);
-    remove_from_access_order(path);
+    auto it = _metadata_map.find(path);
+    if (it != _metadata_map.end()) {
+        erase_locked(it);
+    }
+}
+
+
+void FileMetadataManager::mark_stale(const std::string &path) {
+    unique_lock lock(_mutex);
+    auto it = _metadata_map.find(path);
+    if (it != _metadata_map.end()) {
+        it->second.stale = true;
+    }
+}
+
+
+void FileMetadataManager::mark_all_stale() {
+    unique_lock lock(_mutex);
+    for (auto& [path, entry] : _metadata_map) {
+        entry.stale = true;
+    }
+}
+
+
+void FileMetadataManager::watch_directory(const std::string &dir_path) {
+    unique_lock lock(_mutex);
+    // 开始监听前的变更没有通知, 已有条目需要重新 stat 一次
+    if (_watched_dirs.insert(dir_path).second) {
+        mark_directory_locked(dir_path, true);
+    }
+}
+
+
+void FileMetadataManager::unwatch_directory(const std::string &dir_path) {
+    unique_lock lock(_mutex);
+    if (_watched_dirs.erase(dir_path) > 0) {
+        mark_directory_locked(dir_path, false);
+    }
+}
+
+
+bool FileMetadataManager::refresh_directory(const std::string &dir_path,
+                                            vector<DirectoryEntry> &entries) {
+    return DirectoryScanner::scan(dir_path, [&](vector<DirectoryScanner::Entry>& chunk) {
+        const size_t first = entries.size();
+        for (auto& scanned : chunk) {
+            DirectoryEntry entry;
+            entry.name = std::move(scanned.name);
+            entry.metadata.assign(scanned.st);
+            entries.push_back(std::move(entry));
+        }
+        store_entries(dir_path, entries.data() + first, entries.size() - first);
+        return true;
+    });
+}
+
+
+void FileMetadataManager::store_entries(const std::string &dir_path,
+                                        const DirectoryEntry *entries, size_t count) {
+    const filesystem::path base(dir_path);
+    unique_lock lock(_mutex);
+    for (size_t i = 0; i < count; ++i) {
+        auto it = _metadata_map.find((base / entries[i].name).string());
+        // 已失效的条目留给下次访问重新 stat, 扫描结果可能早于触发失效的那次变更
+        if (it == _metadata_map.end() || it->second.stale) {
+            continue;
+        }
+        Entry& entry = it->second;
+        const auto last_access = entry.metadata.last_access;
+        entry.metadata = entries[i].metadata;
+        entry.metadata.last_access = last_access;
+    }
+}
+
+
+filesystem::file_time_type FileMetadataManager::current_file_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return to_file_time(ts);
 }
 
 
 void FileMetadataManager::cleanup_old_entries(int max_age_days) {
     unique_lock lock(_mutex);
 
-    // 按时间清理
+    // 链表按访问时间有序, 从尾部开始清理到第一个未过期的条目为止
     if (max_age_days > 0) {
         auto now = filesystem::file_time_type::clock::now();
         auto threshold = now - chrono::hours(24 * max_age_days);
 
-        for (auto it = _metadata_map.begin(); it != _metadata_map.end();) {
-            if (it->second.last_access < threshold) {
-                it = _metadata_map.erase(it);
-            } else {
-                ++it;
-            }
+        while (_lru_tail != nullptr && _lru_tail->metadata.last_access < threshold) {
+            erase_locked(_metadata_map.find(*_lru_tail->key));
         }
     }
+}
 
-    rebuild_access_order();
+
+size_t FileMetadataManager::trim(size_t target) {
+    unique_lock lock(_mutex);
+    size_t removed = 0;
+    while (_metadata_map.size() > target) {
+        erase_locked(_metadata_map.find(*_lru_tail->key));
+        removed++;
+    }
+    return removed;
 }
 
 
@@ -130,53 +200,104 @@ bool FileMetadataManager::cached_exists(const std::string &path) {
 
 
 uint64_t FileMetadataManager::cached_file_size(const std::string &path) {
-    auto meta = try_get_metadata(path);
-    if (meta.has_value() && meta->exists && !meta->is_outdated(path)) {
-        return meta->file_size;
-    }
+    // 校验交给 freshness 与变更通知, 命中时不再单独 stat
+    unique_lock lock(_mutex);
+    return touch_locked(path, true).metadata.file_size;
+}
+
 
-    return get_metadata(path).file_size;
+size_t FileMetadataManager::size() const {
+    shared_lock lock(_mutex);
+    return _metadata_map.size();
 }
 
 
-void FileMetadataManager::update_access_order(const std::string &path) {
-    remove_from_access_order(path);
+FileMetadataManager::Entry &FileMetadataManager::touch_locked(const std::string &path, bool refresh,
+                                                             const FileMetadata *known) {
+    auto [it, inserted] = _metadata_map.try_emplace(path);
+    Entry& entry = it->second;
 
-    _access_order.push_front(path);
+    if (inserted) {
+        entry.key = &it->first;
+        entry.watched = is_watched_locked(path);
+        link_front(entry);
 
-    if (_access_order.size() > MAX_ACCESS_ORDER_SIZE) {
-        _access_order.resize(MAX_ACCESS_ORDER_SIZE);
+        // 新条目位于表头, 淘汰只会从尾部移除其他条目
+        while (_metadata_map.size() > _max_entries) {
+            erase_locked(_metadata_map.find(*_lru_tail->key));
+        }
+    } else if (_lru_head != &entry) {
+        unlink(entry);
+        link_front(entry);
     }
+
+    // 已失效的条目总是重新 stat, 不接受 known: 它可能早于触发失效的那次变更
+    const bool expired = !entry.watched &&
+            chrono::steady_clock::now() - entry.metadata.refreshed_at >= _freshness;
+    if (known != nullptr && !entry.stale) {
+        entry.metadata = *known;
+    } else if (inserted || entry.stale || (refresh && expired)) {
+        entry.metadata.refresh(path);
+        entry.stale = false;
+    }
+
+    entry.metadata.last_access = filesystem::file_time_type::clock::now();
+    return entry;
 }
 
-void FileMetadataManager::remove_from_access_order(const std::string& path) {
-    for (auto it = _access_order.begin(); it != _access_order.end();) {
-        if (*it == path) {
-            it = _access_order.erase(it);
-            return;
-        } else {
-            ++it;
-        }
+
+void FileMetadataManager::link_front(Entry &entry) {
+    entry.prev = nullptr;
+    entry.next = _lru_head;
+    if (_lru_head != nullptr) {
+        _lru_head->prev = &entry;
+    }
+    _lru_head = &entry;
+    if (_lru_tail == nullptr) {
+        _lru_tail = &entry;
     }
 }
 
 
-void FileMetadataManager::rebuild_access_order() {
-    _access_order.clear();
+void FileMetadataManager::unlink(Entry &entry) {
+    if (entry.prev != nullptr) {
+        entry.prev->next = entry.next;
+    } else {
+        _lru_head = entry.next;
+    }
+    if (entry.next != nullptr) {
+        entry.next->prev = entry.prev;
+    } else {
+        _lru_tail = entry.prev;
+    }
+    entry.prev = nullptr;
+    entry.next = nullptr;
+}
+
+
+void FileMetadataManager::erase_locked(EntryMap::iterator it) {
+    unlink(it->second);
+    _metadata_map.erase(it);
+}
+
 
-    vector<string> keys;
-    keys.reserve(_metadata_map.size());
-    for (const auto& [key, _] : _metadata_map) {
-        keys.push_back(key);
+bool FileMetadataManager::is_watched_locked(const std::string &path) const {
+    if (_watched_dirs.empty()) {
+        return false;
     }
+    auto pos = path.find_last_of('/');
+    return pos != string::npos && _watched_dirs.count(path.substr(0, pos)) > 0;
+}
 
-    sort(keys.begin(), keys.end(),
-         [this](const string& a, const string& b) {
-        return _metadata_map.at(a).last_access > _metadata_map.at(b).last_access;
-    });
 
-    size_t count = min(keys.size(), MAX_ACCESS_ORDER_SIZE);
-    for (size_t i = 0; i < count; ++i) {
-        _access_order.push_back(keys[i]);
+void FileMetadataManager::mark_directory_locked(const std::string &dir_path, bool watched) {
+    for (auto& [path, entry] : _metadata_map) {
+        if (path.size() > dir_path.size() &&
+            path.compare(0, dir_path.size(), dir_path) == 0 &&
+            path[dir_path.size()] == '/' &&
+            path.find('/', dir_path.size() + 1) == string::npos) {
+            entry.stale = true;
+            entry.watched = watched;
+        }
     }
-}
\ No newline at end of file
+}
@@ -7,25 +7,39 @@
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <shared_mutex>
 #include <chrono>
 #include <filesystem>
 #include <optional>
-#include <list>
 #include <system_error>
 #include <atomic>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using namespace std;
 
+/**
+ * 文件元数据缓存
+ * 条目按访问顺序挂在侵入式 LRU 链表上, 访问与淘汰都是 O(1); 条目数超过上限时插入即淘汰最久未访问的条目
+ * 每次刷新只做一次 fstatat, 距上次刷新不足 freshness 的重复访问直接复用缓存结果
+ * 位于已监听目录中的条目不受 freshness 限制, 只在收到变更通知 (mark_stale) 后才重新 stat
+ */
 class FileMetadataManager {
 
 public:
+    static constexpr size_t DEFAULT_MAX_ENTRIES = 2000;
+    static constexpr chrono::milliseconds DEFAULT_FRESHNESS{50};
+
     struct FileMetadata{
         filesystem::file_time_type last_access;
         filesystem::file_time_type last_modified;
         uint64_t file_size = 0;
         bool exists = false;
+        chrono::steady_clock::time_point refreshed_at{};
 
         FileMetadata() = default;
 
@@ -33,37 +47,104 @@ public:
 
         void refresh(const string& path);
 
+        // 使用 fstatat 的结果填充, dir_fd 为 AT_FDCWD 时 name 为完整路径
+        void refresh_at(int dir_fd, const char* name);
+
+        void assign(const struct stat& st);
+
         bool is_outdated(const string& path) const;
     };
 
+    struct DirectoryEntry {
+        string name;
+        FileMetadata metadata;
+    };
+
+    explicit FileMetadataManager(size_t max_entries = DEFAULT_MAX_ENTRIES,
+                                 chrono::milliseconds freshness = DEFAULT_FRESHNESS);
+
 
-    void update_metadata(const string& path);
+    // 返回刷新后的元数据快照
+    FileMetadata update_metadata(const string& path);
 
     const FileMetadata& get_metadata(const string& path);
 
+    // 不刷新; 已失效的条目视为不存在
     optional<FileMetadata> try_get_metadata(const string& path) const;
 
     void remove_metadata(const string& path);
 
+    // 写入后或收到变更通知时调用, 下次访问时强制刷新
+    void mark_stale(const string& path);
+
+    void mark_all_stale();
+
+    // 目录已被监听, 其中文件的变更会通过 mark_stale 通知
+    void watch_directory(const string& dir_path);
+
+    void unwatch_directory(const string& dir_path);
+
+    // 一次遍历目录 (getdents64), 每个普通文件一次 fstatat, 结果按块刷新已跟踪的条目
+    bool refresh_directory(const string& dir_path, vector<DirectoryEntry>& entries);
+
+    // 批量写入同一目录下已扫描到的元数据, 一次加锁; 只刷新已跟踪的条目且不改变其 LRU 位置,
+    // 扫描大目录不会把热点条目挤出上限 (目录索引已保存全部 mtime)
+    void store_entries(const string& dir_path, const DirectoryEntry* entries, size_t count);
+
+    // 与 last_modified 同一表示的当前时间
+    static filesystem::file_time_type current_file_time();
+
     void cleanup_old_entries(int max_age_days = 14);
 
+    // 从最久未访问的一端淘汰到不超过 target 个条目, 返回淘汰数量
+    size_t trim(size_t target);
+
+    size_t max_entries() const {
+        return _max_entries;
+    }
+
     bool cached_exists(const string& path);
 
     uint64_t cached_file_size(const string& path);
 
+    size_t size() const;
+
 
 private:
-    void update_access_order(const string& path);
+    struct Entry {
+        FileMetadata metadata;
+        // 链表挂钩保存在 map 节点内, unordered_map 的节点地址在 rehash 后保持不变
+        Entry* prev = nullptr;
+        Entry* next = nullptr;
+        const string* key = nullptr;
+        bool stale = false;
+        bool watched = false;
+    };
+
+    using EntryMap = unordered_map<string, Entry>;
+
+    // known 非空时直接使用已获取的元数据, 不再触发系统调用
+    Entry& touch_locked(const string& path, bool refresh, const FileMetadata* known = nullptr);
+
+    void link_front(Entry& entry);
+
+    void unlink(Entry& entry);
+
+    void erase_locked(EntryMap::iterator it);
 
-    void remove_from_access_order(const string& path);
+    bool is_watched_locked(const string& path) const;
 
-    void rebuild_access_order();
+    // 把 dir_path 下所有条目标记为失效并设置 watched
+    void mark_directory_locked(const string& dir_path, bool watched);
 
 
-    unordered_map<string, FileMetadata> _metadata_map;
-    list<string> _access_order;
+    EntryMap _metadata_map;
+    Entry* _lru_head = nullptr;     // 最近访问
+    Entry* _lru_tail = nullptr;     // 最久未访问
+    size_t _max_entries;
+    chrono::milliseconds _freshness;
+    unordered_set<string> _watched_dirs;
     mutable shared_mutex _mutex;
-    static constexpr size_t MAX_ACCESS_ORDER_SIZE = 2000;
 };
 
 
@@ -0,0 +1,27 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_FILEWRITETYPES_H
+#define ANDROIDX_JETPACK_FILEWRITETYPES_H
+
+enum class WriteType {
+    CREATE,
+    UPDATE,
+    APPEND,
+    DELETE
+};
+
+/**
+ * 写入持久化级别
+ * NONE:    只写入页缓存
+ * ORDERED: 数据先落盘再 rename, 掉电后只会看到旧内容或新内容
+ * DURABLE: 在 ORDERED 基础上同步父目录, 完成回调时数据已持久化
+ */
+enum class Durability {
+    NONE = 0,
+    ORDERED = 1,
+    DURABLE = 2
+};
+
+#endif //ANDROIDX_JETPACK_FILEWRITETYPES_H
@@ -0,0 +1,122 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "IoBackend.h"
+#include "IoUringBackend.h"
+#include "utils/log_utils.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOG_TAG "IoBackend"
+
+shared_ptr<IoBackend> IoBackend::create(IoBackend::Kind preferred) {
+    if (preferred == Kind::IO_URING) {
+        if (auto backend = IoUringBackend::create()) {
+            return backend;
+        }
+        // 内核版本过低, 或 seccomp/SELinux 禁止应用使用 io_uring
+        LOGW(LOG_TAG, "io_uring unavailable, falling back to synchronous I/O");
+    }
+    return make_shared<SyncIoBackend>();
+}
+
+
+void SyncIoBackend::execute(vector<FileOp> &ops) {
+    for (auto& op : ops) {
+        op.success = op.content == nullptr || write_file(op.path, *op.content);
+    }
+
+    // 数据先落盘, 之后的 rename 才不会在掉电后指向未写完的内容
+    sync_files(ops);
+
+    for (auto& op : ops) {
+        if (op.success && !op.rename_to.empty()) {
+            op.success = rename(op.path.c_str(), op.rename_to.c_str()) == 0;
+        }
+    }
+}
+
+
+bool SyncIoBackend::write_file(const std::string &path, const std::string &content) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    if (content.size() >= PREALLOCATE_THRESHOLD) {
+        preallocate(fd, content.size());
+    }
+
+    size_t done = 0;
+    bool success = true;
+    while (done < content.size()) {
+        ssize_t written = pwrite(fd, content.data() + done, content.size() - done, static_cast<off_t>(done));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            success = false;
+            break;
+        }
+        done += static_cast<size_t>(written);
+    }
+    return close(fd) == 0 && success;
+}
+
+
+void SyncIoBackend::preallocate(int fd, uint64_t size) {
+    if (size == 0) {
+        return;
+    }
+    // KEEP_SIZE: 写入中途失败时文件长度仍等于实际写入的字节数
+    while (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) != 0 && errno == EINTR) {
+    }
+}
+
+
+bool SyncIoBackend::sync_data(const std::string &path) {
+    // fdatasync 作用于文件本身, 只读打开的 fd 同样可以刷新此前写入的脏页
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    bool success = fdatasync(fd) == 0;
+    close(fd);
+    return success;
+}
+
+
+void SyncIoBackend::sync_files(vector<FileOp> &ops) {
+    vector<FileOp*> pending;
+    for (auto& op : ops) {
+        if (op.success && op.sync) {
+            pending.push_back(&op);
+        }
+    }
+
+    if (pending.empty()) {
+        return;
+    }
+    if (pending.size() == 1) {
+        pending.front()->success = sync_data(pending.front()->path);
+        return;
+    }
+
+    // 多个文件时一次 syncfs 刷新整个文件系统, 比逐个 fdatasync 少得多的设备刷新
+    int fd = open(pending.front()->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd != -1) {
+        bool synced = syscall(SYS_syncfs, fd) == 0;
+        close(fd);
+        if (synced) {
+            return;
+        }
+    }
+
+    for (auto* op : pending) {
+        op->success = sync_data(op->path);
+    }
+}
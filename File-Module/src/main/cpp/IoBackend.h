@@ -0,0 +1,76 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_IOBACKEND_H
+#define ANDROIDX_JETPACK_IOBACKEND_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+using namespace std;
+
+/**
+ * 批量文件 I/O 后端
+ * 一次提交一组整文件写入: 打开 (截断) 并写入内容, 按需 fdatasync, 关闭后按需 rename 到目标路径
+ * 调用方负责加锁与清理失败写入留下的临时文件; 各操作之间互不依赖, 可以并发执行
+ */
+class IoBackend {
+
+public:
+    enum class Kind {
+        SYNC = 0,
+        IO_URING = 1,
+    };
+
+    struct FileOp {
+        string path;
+        const string* content;  // 为空时不写入, 只对已有文件 fdatasync
+        bool sync;
+        string rename_to;       // 非空时在写入 (与落盘) 成功后 rename
+        bool success;
+    };
+
+    // 优先使用 preferred, 当前设备或内核不支持时回退到同步实现, 不会返回 nullptr
+    static shared_ptr<IoBackend> create(Kind preferred);
+
+    virtual ~IoBackend() = default;
+
+    virtual Kind kind() const = 0;
+
+    // 执行全部操作, 结果写入每个操作的 success
+    virtual void execute(vector<FileOp>& ops) = 0;
+};
+
+
+/**
+ * 同步实现: 逐个 open/write/close, 多个文件需要落盘时共用一次 syncfs, 最后依次 rename
+ */
+class SyncIoBackend : public IoBackend {
+
+public:
+    Kind kind() const override {
+        return Kind::SYNC;
+    }
+
+    void execute(vector<FileOp>& ops) override;
+
+    // 超过该大小的内容写入前先预留空间, 减少写入过程中的块分配与碎片
+    static constexpr size_t PREALLOCATE_THRESHOLD = 64 * 1024;
+
+    // 单次 open, 按需预分配后以 pwrite 写入全部内容
+    static bool write_file(const string& path, const string& content);
+
+    // 预留 size 字节的磁盘空间但不改变文件长度; 文件系统不支持时忽略
+    static void preallocate(int fd, uint64_t size);
+
+private:
+    static bool sync_data(const string& path);
+
+    // 未能落盘的操作标记为失败
+    static void sync_files(vector<FileOp>& ops);
+};
+
+
+#endif //ANDROIDX_JETPACK_IOBACKEND_H
@@ -0,0 +1,424 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "IoUringBackend.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// 5.19 之前的内核头文件缺少直接描述符相关定义, 此时只编译同步回退
+#ifdef IORING_FILE_INDEX_ALLOC
+#define FILE_MODULE_HAS_IO_URING 1
+#endif
+
+#ifndef FILE_MODULE_HAS_IO_URING
+
+struct IoUringBackend::Ring {};
+
+shared_ptr<IoUringBackend> IoUringBackend::create() {
+    return nullptr;
+}
+
+void IoUringBackend::execute(vector<FileOp> &ops) {
+    SyncIoBackend().execute(ops);
+}
+
+#else
+
+namespace {
+
+unsigned load_acquire(const unsigned* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void store_release(unsigned* p, unsigned value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+// 链中的步骤, 与操作下标一起编码在 user_data 中
+enum Step : uint64_t {
+    STEP_OPEN = 0,
+    STEP_WRITE = 1,
+    STEP_SYNC = 2,
+    STEP_CLOSE = 3,
+    STEP_RENAME = 4,
+};
+
+constexpr unsigned STEP_BITS = 3;
+
+uint64_t encode_user_data(size_t index, Step step) {
+    return (static_cast<uint64_t>(index) << STEP_BITS) | step;
+}
+
+}
+
+
+struct IoUringBackend::Ring {
+    int fd = -1;
+    void* sq_map = MAP_FAILED;
+    size_t sq_map_size = 0;
+    void* cq_map = MAP_FAILED;
+    size_t cq_map_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cq_mask = 0;
+    // 已填写但尚未发布给内核的 SQE 之后的位置
+    unsigned local_tail = 0;
+
+    static unique_ptr<Ring> open(unsigned entries, unsigned files);
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_map != MAP_FAILED && cq_map != sq_map) {
+            munmap(cq_map, cq_map_size);
+        }
+        if (sq_map != MAP_FAILED) {
+            munmap(sq_map, sq_map_size);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    io_uring_sqe* next_sqe(size_t index, Step step, uint8_t opcode) {
+        if (local_tail - load_acquire(sq_head) >= sq_entries) {
+            return nullptr;
+        }
+        const unsigned slot = local_tail & sq_mask;
+        io_uring_sqe* sqe = &sqes[slot];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->user_data = encode_user_data(index, step);
+        sq_array[slot] = slot;
+        local_tail++;
+        return sqe;
+    }
+
+    // 提交已填写的 count 个 SQE 并等待它们全部完成; 返回 false 时 ring 不能再使用
+    bool submit_and_wait(unsigned count, const function<void(const io_uring_cqe&)>& on_complete) {
+        store_release(sq_tail, local_tail);
+
+        unsigned submitted = 0;
+        while (submitted < count) {
+            long ret = syscall(__NR_io_uring_enter, fd, count - submitted, 0, 0, nullptr, 0);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            submitted += static_cast<unsigned>(ret);
+        }
+
+        unsigned completed = 0;
+        while (completed < count) {
+            unsigned head = *cq_head;
+            const unsigned tail = load_acquire(cq_tail);
+            while (head != tail) {
+                on_complete(cqes[head & cq_mask]);
+                head++;
+                completed++;
+            }
+            store_release(cq_head, head);
+            if (completed >= count) {
+                break;
+            }
+            long ret = syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool supports(const vector<uint8_t>& opcodes) const {
+        const size_t probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        vector<uint8_t> buffer(probe_size, 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            return false;
+        }
+        for (uint8_t opcode : opcodes) {
+            if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 直接描述符 (5.15) 没有对应的探测项, 实际打开并关闭一次根目录
+    bool supports_direct_open() {
+        io_uring_sqe* open_sqe = next_sqe(0, STEP_OPEN, IORING_OP_OPENAT);
+        open_sqe->fd = AT_FDCWD;
+        open_sqe->addr = reinterpret_cast<uint64_t>("/");
+        open_sqe->open_flags = O_RDONLY | O_DIRECTORY;
+        open_sqe->file_index = 1;
+        open_sqe->flags = IOSQE_IO_LINK;
+        io_uring_sqe* close_sqe = next_sqe(0, STEP_CLOSE, IORING_OP_CLOSE);
+        close_sqe->file_index = 1;
+
+        bool success = true;
+        return submit_and_wait(2, [&success](const io_uring_cqe& cqe) {
+            success = success && cqe.res >= 0;
+        }) && success;
+    }
+};
+
+
+unique_ptr<IoUringBackend::Ring> IoUringBackend::Ring::open(unsigned entries, unsigned files) {
+    io_uring_params params{};
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    auto ring = make_unique<Ring>();
+    ring->fd = fd;
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        ring->sq_map_size = ring->cq_map_size = max(ring->sq_map_size, ring->cq_map_size);
+    }
+
+    ring->sq_map = mmap(nullptr, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        return nullptr;
+    }
+    ring->cq_map = single_mmap
+                   ? ring->sq_map
+                   : mmap(nullptr, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd, IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED) {
+        return nullptr;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto* sq = static_cast<char*>(ring->sq_map);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->local_tail = *ring->sq_tail;
+
+    auto* cq = static_cast<char*>(ring->cq_map);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    ring->cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+
+    // 稀疏的直接描述符表, openat 按槽位填入, close 时清空
+    vector<int> fds(files, -1);
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_FILES, fds.data(), files) < 0) {
+        return nullptr;
+    }
+    return ring;
+}
+
+
+shared_ptr<IoUringBackend> IoUringBackend::create() {
+    shared_ptr<IoUringBackend> backend(new IoUringBackend());
+    auto ring = Ring::open(RING_ENTRIES, MAX_FILES_PER_SUBMIT);
+    if (!ring ||
+        !ring->supports({IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT}) ||
+        !ring->supports_direct_open()) {
+        return nullptr;
+    }
+    backend->release_ring(std::move(ring));
+    return backend;
+}
+
+
+void IoUringBackend::execute(vector<FileOp> &ops) {
+    vector<FileOp*> pending;
+    vector<FileOp*> fallback;
+    for (auto& op : ops) {
+        (op.content != nullptr && op.content->size() > MAX_WRITE_SIZE ? fallback : pending).push_back(&op);
+    }
+
+    auto ring = acquire_ring();
+    size_t done = 0;
+    while (ring && done < pending.size()) {
+        const size_t count = min(static_cast<size_t>(MAX_FILES_PER_SUBMIT), pending.size() - done);
+        if (!submit_chunk(*ring, pending.data() + done, count)) {
+            // 本批结果已按失败记录, 其余操作交给同步实现
+            ring.reset();
+        }
+        done += count;
+    }
+    if (ring) {
+        release_ring(std::move(ring));
+    }
+    fallback.insert(fallback.end(), pending.begin() + done, pending.end());
+
+    if (fallback.empty()) {
+        return;
+    }
+    vector<FileOp> sync_ops;
+    sync_ops.reserve(fallback.size());
+    for (auto* op : fallback) {
+        sync_ops.push_back(*op);
+    }
+    SyncIoBackend().execute(sync_ops);
+    for (size_t i = 0; i < fallback.size(); ++i) {
+        fallback[i]->success = sync_ops[i].success;
+    }
+}
+
+
+bool IoUringBackend::submit_chunk(Ring &ring, FileOp *const *ops, size_t count) {
+    struct State {
+        bool opened = false;
+        bool closed = false;
+        bool failed = false;
+    };
+    vector<State> states(count);
+
+    unsigned queued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const FileOp& op = *ops[i];
+        const bool write = op.content != nullptr && !op.content->empty();
+        const bool rename = !op.rename_to.empty();
+        // 槽位号即操作在本批中的下标, file_index 从 1 开始编号
+        const auto slot = static_cast<uint32_t>(i);
+
+        io_uring_sqe* sqe = ring.next_sqe(i, STEP_OPEN, IORING_OP_OPENAT);
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(op.path.c_str());
+        // 直接描述符不接受 O_CLOEXEC
+        sqe->open_flags = op.content != nullptr ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+        sqe->len = 0644;
+        sqe->file_index = slot + 1;
+        sqe->flags = IOSQE_IO_LINK;
+        queued++;
+
+        if (write) {
+            sqe = ring.next_sqe(i, STEP_WRITE, IORING_OP_WRITE);
+            sqe->fd = static_cast<int32_t>(slot);
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            sqe->addr = reinterpret_cast<uint64_t>(op.content->data());
+            sqe->len = static_cast<uint32_t>(op.content->size());
+            sqe->off = 0;
+            queued++;
+        }
+        if (op.sync) {
+            sqe = ring.next_sqe(i, STEP_SYNC, IORING_OP_FSYNC);
+            sqe->fd = static_cast<int32_t>(slot);
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            queued++;
+        }
+
+        sqe = ring.next_sqe(i, STEP_CLOSE, IORING_OP_CLOSE);
+        sqe->file_index = slot + 1;
+        sqe->flags = rename ? IOSQE_IO_LINK : 0;
+        queued++;
+
+        if (rename) {
+            sqe = ring.next_sqe(i, STEP_RENAME, IORING_OP_RENAMEAT);
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(op.path.c_str());
+            sqe->len = static_cast<uint32_t>(AT_FDCWD);
+            sqe->addr2 = reinterpret_cast<uint64_t>(op.rename_to.c_str());
+            queued++;
+        }
+    }
+
+    // 链中失败的步骤返回错误, 之后的步骤以 -ECANCELED 完成; 短写同样会中断链
+    bool usable = ring.submit_and_wait(queued, [&](const io_uring_cqe& cqe) {
+        const size_t index = cqe.user_data >> STEP_BITS;
+        const auto step = static_cast<Step>(cqe.user_data & ((1u << STEP_BITS) - 1));
+        State& state = states[index];
+        if (cqe.res < 0) {
+            state.failed = true;
+            return;
+        }
+        switch (step) {
+            case STEP_OPEN:
+                state.opened = true;
+                break;
+            case STEP_WRITE:
+                if (static_cast<size_t>(cqe.res) != ops[index]->content->size()) {
+                    state.failed = true;
+                }
+                break;
+            case STEP_CLOSE:
+                state.closed = true;
+                break;
+            case STEP_SYNC:
+            case STEP_RENAME:
+                break;
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        ops[i]->success = usable && !states[i].failed;
+    }
+    if (!usable) {
+        return false;
+    }
+
+    // 写入或落盘失败时 close 被取消, 释放仍占用的槽位
+    unsigned cleanup = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (states[i].opened && !states[i].closed) {
+            io_uring_sqe* sqe = ring.next_sqe(i, STEP_CLOSE, IORING_OP_CLOSE);
+            sqe->file_index = static_cast<uint32_t>(i) + 1;
+            cleanup++;
+        }
+    }
+    return cleanup == 0 || ring.submit_and_wait(cleanup, [](const io_uring_cqe&) {});
+}
+
+
+unique_ptr<IoUringBackend::Ring> IoUringBackend::acquire_ring() {
+    {
+        lock_guard lock(_mutex);
+        if (!_idle_rings.empty()) {
+            auto ring = std::move(_idle_rings.back());
+            _idle_rings.pop_back();
+            return ring;
+        }
+    }
+    return Ring::open(RING_ENTRIES, MAX_FILES_PER_SUBMIT);
+}
+
+
+void IoUringBackend::release_ring(unique_ptr<Ring> ring) {
+    lock_guard lock(_mutex);
+    _idle_rings.push_back(std::move(ring));
+}
+
+#endif
+
+
+IoUringBackend::IoUringBackend() = default;
+
+IoUringBackend::~IoUringBackend() = default;
@@ -0,0 +1,61 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_IOURINGBACKEND_H
+#define ANDROIDX_JETPACK_IOURINGBACKEND_H
+
+#include "IoBackend.h"
+#include <mutex>
+
+using namespace std;
+
+/**
+ * io_uring 实现
+ * 每个操作展开为一条链接的 SQE 链: openat (直接描述符) -> write -> fsync -> close -> renameat,
+ * 链中任一步失败时后续步骤被内核取消; 一批操作在一次 io_uring_enter 中提交, 各链之间并发执行
+ * 需要 5.19 以上的内核头文件与 5.15 以上的内核; 不可用时 create 返回 nullptr
+ */
+class IoUringBackend : public IoBackend {
+
+public:
+    static constexpr unsigned RING_ENTRIES = 256;
+    // 一次提交中同时打开的文件数, 即每个 ring 注册的直接描述符槽位数
+    static constexpr unsigned MAX_FILES_PER_SUBMIT = 32;
+    // 每个操作的链最多 5 个 SQE (open, write, fsync, close, rename)
+    static constexpr unsigned MAX_SQES_PER_FILE = 5;
+    // 一批操作的链必须一次放进提交队列, 链不能跨两次提交拆开, submit_chunk 因此不检查 next_sqe 的返回值
+    static_assert(MAX_FILES_PER_SUBMIT * MAX_SQES_PER_FILE <= RING_ENTRIES,
+                  "a full chunk of SQE chains must fit in the submission queue");
+    // 单次写入超过该大小时交给同步实现, 不受 io_uring 单次读写上限的约束
+    static constexpr size_t MAX_WRITE_SIZE = 1u << 30;
+
+    static shared_ptr<IoUringBackend> create();
+
+    ~IoUringBackend() override;
+
+    Kind kind() const override {
+        return Kind::IO_URING;
+    }
+
+    void execute(vector<FileOp>& ops) override;
+
+private:
+    struct Ring;
+
+    IoUringBackend();
+
+    // ring 不能并发使用, 每个执行中的线程各取一个, 用完放回
+    unique_ptr<Ring> acquire_ring();
+
+    void release_ring(unique_ptr<Ring> ring);
+
+    // 执行不超过 MAX_FILES_PER_SUBMIT 个操作, ring 出现不可恢复的错误时返回 false
+    bool submit_chunk(Ring& ring, FileOp* const* ops, size_t count);
+
+    mutex _mutex;
+    vector<unique_ptr<Ring>> _idle_rings;
+};
+
+
+#endif //ANDROIDX_JETPACK_IOURINGBACKEND_H
@@ -0,0 +1,392 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "PackedFileStore.h"
+#include "DirectoryScanner.h"
+#include "FileMetadataManager.h"
+#include <algorithm>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+namespace {
+
+bool pwrite_fully(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool sync_directory(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    bool success = fsync(fd) == 0;
+    close(fd);
+    return success;
+}
+
+}
+
+
+unique_ptr<PackedFileStore> PackedFileStore::open(const std::string &dir_path, bool create) {
+    const string pack_dir = (filesystem::path(dir_path) / PACK_DIRECTORY).string();
+    const string segment_path = (filesystem::path(pack_dir) / SEGMENT_FILENAME).string();
+
+    if (create) {
+        error_code ec;
+        filesystem::create_directories(pack_dir, ec);
+    }
+    int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0);
+    int fd = ::open(segment_path.c_str(), flags, 0644);
+    if (fd == -1) {
+        return nullptr;
+    }
+    if (create) {
+        // 段文件的目录项需要持久化, 之后的记录只追加内容
+        sync_directory(pack_dir);
+        sync_directory(dir_path);
+    }
+
+    // 上次压缩中途退出的残留
+    unlink((segment_path + COMPACT_SUFFIX).c_str());
+
+    unique_ptr<PackedFileStore> store(new PackedFileStore(dir_path, segment_path, fd));
+    if (!store->load()) {
+        return nullptr;
+    }
+
+    // 目录中还没有普通文件时, 之后的包内写入不必尝试删除同名文件
+    bool loose = false;
+    DirectoryScanner::scan(dir_path, [&loose](vector<DirectoryScanner::Entry>&) {
+        loose = true;
+        return false;
+    }, 1, 0);
+    store->_loose_files.store(loose, memory_order_release);
+    return store;
+}
+
+
+PackedFileStore::PackedFileStore(string dir_path, string segment_path, int fd)
+        : _dir_path(std::move(dir_path)), _segment_path(std::move(segment_path)), _fd(fd) {}
+
+
+PackedFileStore::~PackedFileStore() {
+    close(_fd);
+}
+
+
+bool PackedFileStore::get(const std::string &name, std::string &output) const {
+    shared_lock lock(_mutex);
+    auto it = _index.find(name);
+    if (it == _index.end()) {
+        return false;
+    }
+
+    const Location& location = it->second;
+    string value(location.value_size, '\0');
+    size_t done = 0;
+    while (done < value.size()) {
+        ssize_t n = pread(_fd, value.data() + done, value.size() - done,
+                          static_cast<off_t>(location.value_offset() + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    output = std::move(value);
+    return true;
+}
+
+
+bool PackedFileStore::contains(const std::string &name) const {
+    shared_lock lock(_mutex);
+    return _index.find(name) != _index.end();
+}
+
+
+bool PackedFileStore::put(const std::string &name, const std::string &content, Durability durability) {
+    if (content.size() > MAX_VALUE_SIZE) {
+        return false;
+    }
+    lock_guard write_lock(_write_mutex);
+    return put_locked(name, content, durability);
+}
+
+
+bool PackedFileStore::append(const std::string &name, const std::string &content, Durability durability,
+                             const function<bool(const std::string &)> &spill) {
+    lock_guard write_lock(_write_mutex);
+    string combined;
+    const bool existed = get(name, combined);
+    combined.append(content);
+    if (combined.size() <= MAX_VALUE_SIZE) {
+        return put_locked(name, combined, durability);
+    }
+
+    // 迁出为普通文件期间其他写入等待, 读取仍返回包内的旧内容
+    mark_loose_files();
+    if (!spill(combined)) {
+        return false;
+    }
+    return !existed || remove_locked(name, durability);
+}
+
+
+bool PackedFileStore::remove(const std::string &name, Durability durability) {
+    lock_guard write_lock(_write_mutex);
+    return remove_locked(name, durability);
+}
+
+
+void PackedFileStore::query(const DirectoryIndex::Filter &filter, vector<std::string> &files) const {
+    shared_lock lock(_mutex);
+    for (const auto& [name, location] : _index) {
+        if (filter.accepts(name, FileTime(FileTime::duration(location.mtime)))) {
+            files.push_back(name);
+        }
+    }
+}
+
+
+size_t PackedFileStore::size() const {
+    shared_lock lock(_mutex);
+    return _index.size();
+}
+
+
+bool PackedFileStore::compact_if_needed(double min_dead_ratio, uint64_t min_dead_bytes) {
+    lock_guard write_lock(_write_mutex);
+    // 持有写入锁期间索引只会被读取, 无需再加锁
+    const uint64_t dead_bytes = _end - _live_bytes;
+    if (dead_bytes < min_dead_bytes || dead_bytes < _end * min_dead_ratio) {
+        return false;
+    }
+
+    void* addr = mmap(nullptr, _end, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    madvise(addr, _end, MADV_SEQUENTIAL);
+
+    const string compact_path = _segment_path + COMPACT_SUFFIX;
+    int fd = ::open(compact_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        munmap(addr, _end);
+        return false;
+    }
+
+    // 按原偏移顺序写出存活记录, 记录内容 (含 CRC) 原样拷贝
+    vector<pair<const string*, uint64_t>> live;
+    live.reserve(_index.size());
+    for (const auto& [name, location] : _index) {
+        live.emplace_back(&name, location.offset);
+    }
+    sort(live.begin(), live.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second;
+    });
+
+    unordered_map<string, uint64_t> new_offsets;
+    new_offsets.reserve(live.size());
+    string buffer;
+    uint64_t written = 0;
+    bool success = true;
+    for (const auto& [name, offset] : live) {
+        const Location& location = _index.at(*name);
+        buffer.append(static_cast<const char*>(addr) + offset, location.record_size());
+        new_offsets.emplace(*name, written + buffer.size() - location.record_size());
+        if (buffer.size() >= 1024 * 1024) {
+            success = pwrite_fully(fd, buffer.data(), buffer.size(), written);
+            written += buffer.size();
+            buffer.clear();
+            if (!success) {
+                break;
+            }
+        }
+    }
+    if (success && !buffer.empty()) {
+        success = pwrite_fully(fd, buffer.data(), buffer.size(), written);
+        written += buffer.size();
+    }
+    munmap(addr, _end);
+
+    // 新段文件落盘后再替换, 掉电后看到的要么是旧段文件要么是完整的新段文件
+    const string pack_dir = filesystem::path(_segment_path).parent_path().string();
+    success = success && fdatasync(fd) == 0 &&
+              rename(compact_path.c_str(), _segment_path.c_str()) == 0;
+    if (!success) {
+        close(fd);
+        unlink(compact_path.c_str());
+        return false;
+    }
+    sync_directory(pack_dir);
+
+    unique_lock lock(_mutex);
+    for (auto& [name, location] : _index) {
+        location.offset = new_offsets.at(name);
+    }
+    close(_fd);
+    _fd = fd;
+    _end = written;
+    _live_bytes = written;
+    return true;
+}
+
+
+bool PackedFileStore::load() {
+    struct stat sb;
+    if (fstat(_fd, &sb) == -1) {
+        return false;
+    }
+    const auto file_size = static_cast<uint64_t>(sb.st_size);
+    if (file_size == 0) {
+        return true;
+    }
+
+    void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    madvise(addr, file_size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(addr);
+
+    uint64_t offset = 0;
+    while (file_size - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        const uint64_t record_size = sizeof(header) + static_cast<uint64_t>(header.name_size) + header.value_size;
+        if (header.magic != RECORD_MAGIC || record_size > file_size - offset) {
+            break;
+        }
+        const char* name = data + offset + sizeof(header);
+        if (record_crc(header, name, name + header.name_size) != header.crc) {
+            break;
+        }
+
+        string key(name, header.name_size);
+        if (header.type == RECORD_PUT) {
+            Location location{offset, header.name_size, header.value_size, header.mtime};
+            auto [it, inserted] = _index.try_emplace(std::move(key), location);
+            if (!inserted) {
+                _live_bytes -= it->second.record_size();
+                it->second = location;
+            }
+            _live_bytes += record_size;
+        } else {
+            auto it = _index.find(key);
+            if (it != _index.end()) {
+                _live_bytes -= it->second.record_size();
+                _index.erase(it);
+            }
+        }
+        offset += record_size;
+    }
+    munmap(addr, file_size);
+
+    _end = offset;
+    // 末尾是写入中途崩溃留下的不完整记录, 截掉后从这里继续追加
+    if (offset < file_size && ftruncate(_fd, static_cast<off_t>(offset)) != 0) {
+        return false;
+    }
+    return true;
+}
+
+
+bool PackedFileStore::put_locked(const std::string &name, const std::string &content, Durability durability) {
+    Location location{};
+    if (!append_record(RECORD_PUT, name, content, durability, location)) {
+        return false;
+    }
+
+    unique_lock lock(_mutex);
+    auto [it, inserted] = _index.try_emplace(name, location);
+    if (!inserted) {
+        _live_bytes -= it->second.record_size();
+        it->second = location;
+    }
+    _live_bytes += location.record_size();
+    _end = location.offset + location.record_size();
+    return true;
+}
+
+
+bool PackedFileStore::remove_locked(const std::string &name, Durability durability) {
+    // 只有持有写入锁的线程修改索引, 检查与追加之间条目不会消失
+    if (!contains(name)) {
+        return false;
+    }
+
+    Location location{};
+    if (!append_record(RECORD_DELETE, name, string(), durability, location)) {
+        return false;
+    }
+
+    unique_lock lock(_mutex);
+    auto it = _index.find(name);
+    _live_bytes -= it->second.record_size();
+    _index.erase(it);
+    _end = location.offset + location.record_size();
+    return true;
+}
+
+
+bool PackedFileStore::append_record(RecordType type, const std::string &name, const std::string &value,
+                                    Durability durability, Location &location) {
+    RecordHeader header{};
+    header.magic = RECORD_MAGIC;
+    header.type = type;
+    header.name_size = static_cast<uint32_t>(name.size());
+    header.value_size = static_cast<uint32_t>(value.size());
+    header.mtime = FileMetadataManager::current_file_time().time_since_epoch().count();
+    header.crc = record_crc(header, name.data(), value.data());
+
+    // 头部, 文件名与内容合并为一次写入
+    string record;
+    record.reserve(sizeof(header) + name.size() + value.size());
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    record.append(name);
+    record.append(value);
+
+    if (!pwrite_fully(_fd, record.data(), record.size(), _end)) {
+        // 回滚部分写入, 保证段文件以完整记录结尾
+        ftruncate(_fd, static_cast<off_t>(_end));
+        return false;
+    }
+    // 段文件已存在, 落盘只需 fdatasync, 不涉及目录项
+    if (durability != Durability::NONE && fdatasync(_fd) != 0) {
+        return false;
+    }
+
+    location = Location{_end, header.name_size, header.value_size, header.mtime};
+    return true;
+}
+
+
+uint32_t PackedFileStore::record_crc(const RecordHeader &header, const char *name, const char *value) {
+    const size_t skip = offsetof(RecordHeader, type);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(&header) + skip, sizeof(header) - skip);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(name), header.name_size);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(value), header.value_size);
+    return static_cast<uint32_t>(crc);
+}
@@ -0,0 +1,142 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_PACKEDFILESTORE_H
+#define ANDROIDX_JETPACK_PACKEDFILESTORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include "FileWriteTypes.h"
+#include "DirectoryIndex.h"
+
+using namespace std;
+
+/**
+ * 小文件打包存储
+ * 业务目录下的小文件以记录形式追加到 ".pack/segment" 中, 内存中的哈希表按文件名索引记录位置;
+ * 写入与删除只追加记录, 不再为每个文件分配 inode 与目录项; 失效记录由后台压缩回收
+ * 记录带 CRC 校验, 打开时顺序重放建立索引, 末尾不完整的记录 (写入中途崩溃) 被截掉
+ */
+class PackedFileStore {
+
+public:
+    using FileTime = filesystem::file_time_type;
+
+    static constexpr const char* PACK_DIRECTORY = ".pack";
+    static constexpr const char* SEGMENT_FILENAME = "segment";
+    static constexpr const char* COMPACT_SUFFIX = ".compact";
+    // 超过该大小的内容仍写为普通文件
+    static constexpr size_t MAX_VALUE_SIZE = 4096;
+    static constexpr double COMPACT_DEAD_RATIO = 0.5;
+    static constexpr uint64_t COMPACT_MIN_DEAD_BYTES = 1024 * 1024;
+
+    // 目录下没有打包存储且 create 为 false 时返回 nullptr
+    static unique_ptr<PackedFileStore> open(const string& dir_path, bool create);
+
+    ~PackedFileStore();
+
+    PackedFileStore(const PackedFileStore&) = delete;
+
+    PackedFileStore& operator=(const PackedFileStore&) = delete;
+
+    bool get(const string& name, string& output) const;
+
+    bool contains(const string& name) const;
+
+    bool put(const string& name, const string& content, Durability durability);
+
+    // 追加后超过 MAX_VALUE_SIZE 时把完整内容交给 spill 写为普通文件, 成功后删除包内记录
+    // 整个过程持有写入锁, 同一文件的并发追加不会丢失
+    bool append(const string& name, const string& content, Durability durability,
+                const function<bool(const string& combined)>& spill);
+
+    // 文件不在包内时返回 false, 不写入记录
+    bool remove(const string& name, Durability durability);
+
+    void query(const DirectoryIndex::Filter& filter, vector<string>& files) const;
+
+    size_t size() const;
+
+    // 目录中可能存在普通文件; 为 false 时包内写入无需再删除同名的普通文件
+    bool has_loose_files() const {
+        return _loose_files.load(memory_order_acquire);
+    }
+
+    void mark_loose_files() {
+        _loose_files.store(true, memory_order_release);
+    }
+
+    // 失效字节占比与数量都超过阈值时重写段文件, 返回是否执行了压缩
+    // 压缩期间写入等待, 读取不受影响
+    bool compact_if_needed(double min_dead_ratio = COMPACT_DEAD_RATIO,
+                           uint64_t min_dead_bytes = COMPACT_MIN_DEAD_BYTES);
+
+private:
+    static constexpr uint32_t RECORD_MAGIC = 0x314B5046; // "FPK1"
+
+    enum RecordType : uint32_t {
+        RECORD_PUT = 1,
+        RECORD_DELETE = 2,
+    };
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t crc;           // 覆盖 type 之后的头部, 文件名与内容
+        uint32_t type;
+        uint32_t name_size;
+        uint32_t value_size;
+        uint32_t reserved;
+        int64_t mtime;          // FileTime 的计数值
+    };
+
+    struct Location {
+        uint64_t offset;        // 记录起始位置
+        uint32_t name_size;
+        uint32_t value_size;
+        int64_t mtime;
+
+        uint64_t record_size() const {
+            return sizeof(RecordHeader) + name_size + value_size;
+        }
+
+        uint64_t value_offset() const {
+            return offset + sizeof(RecordHeader) + name_size;
+        }
+    };
+
+    PackedFileStore(string dir_path, string segment_path, int fd);
+
+    // 重放段文件建立索引, 截掉末尾无法校验的部分
+    bool load();
+
+    // 以下两个函数要求调用方持有 _write_mutex
+    bool put_locked(const string& name, const string& content, Durability durability);
+
+    bool remove_locked(const string& name, Durability durability);
+
+    bool append_record(RecordType type, const string& name, const string& value,
+                       Durability durability, Location& location);
+
+    static uint32_t record_crc(const RecordHeader& header, const char* name, const char* value);
+
+    string _dir_path;
+    string _segment_path;
+    unordered_map<string, Location> _index;
+    int _fd;
+    uint64_t _end = 0;          // 段文件的有效长度
+    uint64_t _live_bytes = 0;   // 索引引用的记录总长度
+    atomic<bool> _loose_files{true};
+    mutex _write_mutex;         // 串行化追加与压缩
+    mutable shared_mutex _mutex;  // 保护索引与 _fd
+};
+
+
+#endif //ANDROIDX_JETPACK_PACKEDFILESTORE_H
@@ -0,0 +1,112 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_SHARDEDLRUCACHE_H
+#define ANDROIDX_JETPACK_SHARDEDLRUCACHE_H
+
+#include "ConcurrentLRUCache.h"
+#include "ClockLRUCache.h"
+#include <vector>
+#include <memory>
+#include <optional>
+#include <functional>
+
+using namespace std;
+
+/**
+ * 分片缓存
+ * 按 key 的哈希选择分片, 每个分片拥有独立的锁、链表与索引, 不相关的 key 互不竞争
+ * Shard 默认为 ClockLRUCache(命中无独占锁), 需要精确 LRU 时可使用 ConcurrentLRUCache
+ */
+template <typename Key, typename Value,
+        typename Shard = ClockLRUCache<Key, Value>,
+        typename Hash = hash<Key>>
+class ShardedLRUCache {
+
+public:
+    static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+
+    explicit ShardedLRUCache(size_t capacity, size_t shard_count = DEFAULT_SHARD_COUNT)
+            : _capacity(capacity > 0 ? capacity : 1) {
+        size_t count = 1;
+        while (count < shard_count && count < _capacity) {
+            count <<= 1;
+        }
+        _shard_mask = count - 1;
+
+        size_t shard_capacity = (_capacity + count - 1) / count;
+        _shards.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            _shards.push_back(make_unique<Shard>(shard_capacity));
+        }
+    }
+
+    bool put(const Key& key, Value&& value) {
+        return shard_for(key).put(key, std::move(value));
+    }
+
+    bool put(const Key& key, const Value& value) {
+        return shard_for(key).put(key, value);
+    }
+
+    optional<Value> get(const Key& key) {
+        return shard_for(key).get(key);
+    }
+
+    bool remove(const Key& key) {
+        return shard_for(key).remove(key);
+    }
+
+    bool contains(const Key& key) const {
+        return shard_for(key).contains(key);
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : _shards) {
+            total += shard->size();
+        }
+        return total;
+    }
+
+    void clear() {
+        for (auto& shard : _shards) {
+            shard->clear();
+        }
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    size_t shard_count() const {
+        return _shards.size();
+    }
+
+    // 目标按分片均分, 各分片独立淘汰, 返回淘汰总数
+    size_t trim(size_t target) {
+        const size_t shard_target = target / _shards.size();
+        size_t removed = 0;
+        for (auto& shard : _shards) {
+            removed += shard->trim(shard_target);
+        }
+        return removed;
+    }
+
+private:
+    Shard& shard_for(const Key& key) const {
+        size_t h = _hasher(key);
+        // 混合高位, 避免哈希低位分布不均时集中到少数分片
+        h ^= (h >> 16);
+        return *_shards[h & _shard_mask];
+    }
+
+    size_t _capacity;
+    size_t _shard_mask;
+    vector<unique_ptr<Shard>> _shards;
+    Hash _hasher;
+};
+
+
+#endif //ANDROIDX_JETPACK_SHARDEDLRUCACHE_H
@@ -0,0 +1,239 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#include "WriteAheadJournal.h"
+#include <cstring>
+#include <atomic>
+#include <sys/file.h>
+
+
+WriteAheadJournal::~WriteAheadJournal() {
+    close_mapping();
+}
+
+
+int WriteAheadJournal::acquire(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return -1;
+    }
+    // flock 归属于打开的文件描述, 同一进程内的第二个实例同样会失败
+    while (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+
+vector<WriteAheadJournal::Record> WriteAheadJournal::recover(int fd) {
+    vector<Record> records;
+
+    Header hdr{};
+    struct stat sb;
+    bool valid = fstat(fd, &sb) == 0 &&
+                 static_cast<size_t>(sb.st_size) >= HEADER_SIZE &&
+                 pread(fd, &hdr, sizeof(hdr), 0) == static_cast<ssize_t>(sizeof(hdr)) &&
+                 hdr.magic == JOURNAL_MAGIC &&
+                 hdr.capacity > 0 &&
+                 static_cast<uint64_t>(sb.st_size) >= HEADER_SIZE + hdr.capacity &&
+                 hdr.tail >= hdr.head &&
+                 hdr.tail - hdr.head <= hdr.capacity;
+    if (!valid || hdr.tail == hdr.head) {
+        return records;
+    }
+
+    string ring(hdr.capacity, '\0');
+    ssize_t n = pread(fd, ring.data(), ring.size(), HEADER_SIZE);
+    if (n != static_cast<ssize_t>(ring.size())) {
+        return records;
+    }
+
+    // 只扫描 [head, tail), 区间外可能是上一圈已经执行过的旧记录
+    uint64_t offset = hdr.head;
+    while (offset < hdr.tail) {
+        const uint64_t pos = offset % hdr.capacity;
+        const uint64_t remaining = hdr.capacity - pos;
+        if (remaining < sizeof(RecordHeader)) {
+            offset += remaining;
+            continue;
+        }
+
+        RecordHeader rh{};
+        memcpy(&rh, ring.data() + pos, sizeof(rh));
+        if (rh.magic == PAD_MAGIC) {
+            offset += remaining;
+            continue;
+        }
+        if (rh.magic != RECORD_MAGIC && rh.magic != DONE_MAGIC) {
+            break;
+        }
+
+        const size_t size = record_size(rh.path_size, rh.payload_size);
+        if (size > remaining || offset + size > hdr.tail) {
+            break;
+        }
+        if (rh.magic == DONE_MAGIC) {
+            offset += size;
+            continue;
+        }
+
+        const char* body = ring.data() + pos + sizeof(RecordHeader);
+        records.push_back(Record{
+                rh.seq,
+                static_cast<WriteType>(rh.type),
+                static_cast<Durability>(rh.durability),
+                string(body, rh.path_size),
+                string(body + rh.path_size, rh.payload_size)
+        });
+        offset += size;
+    }
+    return records;
+}
+
+
+bool WriteAheadJournal::open(int fd, size_t capacity) {
+    lock_guard lock(_mutex);
+    close_mapping();
+    _fd = fd;
+
+    capacity = (capacity + 7) & ~static_cast<size_t>(7);
+    if (_fd == -1 || capacity < sizeof(RecordHeader)) {
+        close_mapping();
+        return false;
+    }
+
+    // 先截断为 0 丢弃旧记录, 再扩展到映射大小
+    const size_t mapped_size = HEADER_SIZE + capacity;
+    if (ftruncate(_fd, 0) != 0 || ftruncate(_fd, static_cast<off_t>(mapped_size)) != 0) {
+        close_mapping();
+        return false;
+    }
+
+    // MAP_SHARED 的写入直接进入页缓存, 进程退出后由内核负责回写
+    void* addr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (addr == MAP_FAILED) {
+        close_mapping();
+        return false;
+    }
+
+    _base = static_cast<char*>(addr);
+    _mapped_size = mapped_size;
+    _capacity = capacity;
+    _head = 0;
+    _tail = 0;
+    _next_seq = 1;
+    _first_inflight_seq = 1;
+    _inflight.clear();
+
+    Header* hdr = header();
+    hdr->capacity = capacity;
+    hdr->head = 0;
+    hdr->tail = 0;
+    __atomic_store_n(&hdr->magic, JOURNAL_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+
+bool WriteAheadJournal::append(WriteType type, const std::string &path, const std::string &payload,
+                               Durability durability, uint64_t &seq) {
+    const size_t size = record_size(path.size(), payload.size());
+
+    lock_guard lock(_mutex);
+    if (_base == nullptr || size > _capacity) {
+        return false;
+    }
+
+    uint64_t pos = _tail % _capacity;
+    const uint64_t remaining = _capacity - pos;
+    // 记录不跨越环尾, 放不下时跳到下一圈的起点
+    const uint64_t skip = size > remaining ? remaining : 0;
+    if ((_tail - _head) + skip + size > _capacity) {
+        return false;
+    }
+
+    if (skip > 0) {
+        if (remaining >= sizeof(RecordHeader)) {
+            auto* pad = reinterpret_cast<RecordHeader*>(data() + pos);
+            __atomic_store_n(&pad->magic, PAD_MAGIC, __ATOMIC_RELEASE);
+        }
+        _tail += skip;
+        pos = 0;
+    }
+
+    char* dest = data() + pos;
+    auto* rh = reinterpret_cast<RecordHeader*>(dest);
+    rh->magic = 0;
+    rh->type = static_cast<uint8_t>(type);
+    rh->durability = static_cast<uint8_t>(durability);
+    rh->reserved = 0;
+    rh->seq = _next_seq;
+    rh->path_size = static_cast<uint32_t>(path.size());
+    rh->payload_size = static_cast<uint32_t>(payload.size());
+    memcpy(dest + sizeof(RecordHeader), path.data(), path.size());
+    memcpy(dest + sizeof(RecordHeader) + path.size(), payload.data(), payload.size());
+    // magic 最后写入, 写到一半时进程被杀不会留下看似完整的记录
+    __atomic_store_n(&rh->magic, RECORD_MAGIC, __ATOMIC_RELEASE);
+
+    _tail += size;
+    __atomic_store_n(&header()->tail, _tail, __ATOMIC_RELEASE);
+
+    seq = _next_seq++;
+    _inflight.push_back(Inflight{_tail - size, _tail, false});
+    return true;
+}
+
+
+void WriteAheadJournal::release(uint64_t seq) {
+    lock_guard lock(_mutex);
+    if (seq < _first_inflight_seq || seq >= _next_seq) {
+        return;
+    }
+
+    auto& record = _inflight[seq - _first_inflight_seq];
+    record.done = true;
+    // 头指针之后乱序完成的记录在重放时跳过
+    auto* rh = reinterpret_cast<RecordHeader*>(data() + record.start % _capacity);
+    __atomic_store_n(&rh->magic, DONE_MAGIC, __ATOMIC_RELEASE);
+
+    // 多个工作线程的完成顺序不确定, 头指针只越过连续完成的记录
+    bool advanced = false;
+    while (!_inflight.empty() && _inflight.front().done) {
+        _head = _inflight.front().end;
+        _inflight.pop_front();
+        _first_inflight_seq++;
+        advanced = true;
+    }
+    if (advanced) {
+        __atomic_store_n(&header()->head, _head, __ATOMIC_RELEASE);
+    }
+}
+
+
+size_t WriteAheadJournal::used_bytes() const {
+    lock_guard lock(_mutex);
+    return static_cast<size_t>(_tail - _head);
+}
+
+
+size_t WriteAheadJournal::record_size(size_t path_size, size_t payload_size) {
+    size_t size = sizeof(RecordHeader) + path_size + payload_size;
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+
+void WriteAheadJournal::close_mapping() {
+    if (_base != nullptr) {
+        munmap(_base, _mapped_size);
+        _base = nullptr;
+        _mapped_size = 0;
+    }
+    if (_fd != -1) {
+        // 关闭即释放 flock
+        close(_fd);
+        _fd = -1;
+    }
+}
@@ -0,0 +1,126 @@
+//
+// Created by 64860 on 2026/10/17.
+//
+
+#ifndef ANDROIDX_JETPACK_WRITEAHEADJOURNAL_H
+#define ANDROIDX_JETPACK_WRITEAHEADJOURNAL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FileWriteTypes.h"
+
+using namespace std;
+
+/**
+ * 异步写入的预写日志
+ * 基于 mmap 的环形缓冲区: 请求入队前把 (op, path, payload) 序列化到共享映射中, 只有内存拷贝没有系统调用;
+ * 进程被杀后数据仍留在页缓存, 下次启动时 recover 读出未执行的记录按顺序重放
+ * 记录执行完成后 release: 记录在映射中标记为已完成, 头指针越过所有已完成的连续记录即完成截断;
+ * 多个工作线程乱序完成时, 头指针之后已完成的记录在重放时跳过
+ * 只有执行完成但尚未 release 时进程退出的记录会被再次执行, 对应的 append 会重复
+ * 日志文件以 flock 独占, 同一 basePath 的其他实例 (本进程或其他进程) 无法取得时不重放也不截断
+ */
+class WriteAheadJournal {
+
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+    static constexpr const char* JOURNAL_FILENAME = ".write_journal";
+
+    struct Record {
+        uint64_t seq;
+        WriteType type;
+        Durability durability;
+        string path;
+        string payload;
+    };
+
+    WriteAheadJournal() = default;
+
+    ~WriteAheadJournal();
+
+    WriteAheadJournal(const WriteAheadJournal&) = delete;
+
+    WriteAheadJournal& operator=(const WriteAheadJournal&) = delete;
+
+    // 打开并独占日志文件, 返回的 fd 持有 flock; 已被其他实例持有或打开失败时返回 -1
+    static int acquire(const string& path);
+
+    // 从 acquire 得到的 fd 读出上次运行遗留的未执行记录, 按写入顺序返回
+    static vector<Record> recover(int fd);
+
+    // 接管 acquire 得到的 fd (无论成功与否), 截断旧内容后建立映射, 实例析构前一直持有 flock
+    // 调用前应先 recover 并重放
+    bool open(int fd, size_t capacity = DEFAULT_CAPACITY);
+
+    // 空间不足时返回 false
+    bool append(WriteType type, const string& path, const string& payload,
+                Durability durability, uint64_t& seq);
+
+    void release(uint64_t seq);
+
+    size_t used_bytes() const;
+
+private:
+    static constexpr uint32_t JOURNAL_MAGIC = 0x57414C31;  // "WAL1"
+    static constexpr uint32_t RECORD_MAGIC = 0x52454331;   // "REC1"
+    static constexpr uint32_t PAD_MAGIC = 0x50414431;      // "PAD1"
+    static constexpr uint32_t DONE_MAGIC = 0x444F4E31;     // "DON1", 已执行完成的记录
+    static constexpr size_t HEADER_SIZE = 4096;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t capacity;
+        uint64_t head;          // 最旧的未完成记录的逻辑偏移
+        uint64_t tail;          // 下一条记录的逻辑偏移
+    };
+
+    struct RecordHeader {
+        uint32_t magic;         // 最后写入, 非 RECORD_MAGIC/DONE_MAGIC 表示记录不完整
+        uint8_t type;
+        uint8_t durability;
+        uint16_t reserved;
+        uint64_t seq;
+        uint32_t path_size;
+        uint32_t payload_size;
+    };
+
+    struct Inflight {
+        uint64_t start;
+        uint64_t end;
+        bool done;
+    };
+
+    static size_t record_size(size_t path_size, size_t payload_size);
+
+    char* data() const {
+        return _base + HEADER_SIZE;
+    }
+
+    Header* header() const {
+        return reinterpret_cast<Header*>(_base);
+    }
+
+    void close_mapping();
+
+    int _fd = -1;
+    char* _base = nullptr;
+    size_t _mapped_size = 0;
+    uint64_t _capacity = 0;
+    uint64_t _head = 0;
+    uint64_t _tail = 0;
+    uint64_t _next_seq = 1;
+    deque<Inflight> _inflight;  // 与 [_first_inflight_seq, _next_seq) 一一对应
+    uint64_t _first_inflight_seq = 1;
+    mutable mutex _mutex;
+};
+
+
+#endif //ANDROIDX_JETPACK_WRITEAHEADJOURNAL_H
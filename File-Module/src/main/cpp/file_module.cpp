@@ -1,21 +1,62 @@
 #include <jni.h>
 #include <string>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <limits>
+#include <cstring>
+#include <future>
 #include "FileInterface.h"
 #include "utils/log_utils.h"
 
 #define TAG "file_module.h"
 
+// 交给 Java 的映射视图, 以 ByteBuffer 地址为 key, unmapFile 时释放
+static std::mutex g_mapped_mutex;
+static std::unordered_map<const void *, AtomicFileOperator::MappedView> g_mapped_views;
+static char g_empty_mapping;
+
+// 交给 Java 的读写流游标, 以递增的句柄为 key; 句柄不复用, 关闭后再次使用只会失败而不会访问已释放的流
+static std::mutex g_stream_mutex;
+static jlong g_next_stream_handle = 1;
+static std::unordered_map<jlong, std::shared_ptr<FileReadStream>> g_read_streams;
+static std::unordered_map<jlong, std::shared_ptr<FileWriteStream>> g_write_streams;
+
+// submitWrite 返回的完成句柄, 与流共用句柄序号; awaitWrite 取得结果后释放
+static std::unordered_map<jlong, std::shared_future<bool>> g_pending_writes;
+
+// submitBatchWrite 返回的完成句柄; indexes 为提交的写入在 Java 数组中的下标
+struct PendingBatch {
+    std::shared_future<std::vector<bool>> results;
+    std::vector<jsize> indexes;
+    jsize count = 0;
+};
+static std::unordered_map<jlong, PendingBatch> g_pending_batches;
+
 static jboolean
-initManager(JNIEnv *env, jobject instance, jstring base_path, jint cache_size, jboolean use_async) {
+initManager(JNIEnv *env, jobject instance, jstring base_path, jint cache_size, jboolean use_async,
+            jint writer_threads, jint journal_bytes, jboolean watch_directories,
+            jboolean cross_process_locks) {
     const char *path_chars = env->GetStringUTFChars(base_path, nullptr);
     if (!path_chars) {
         LOGE(TAG, "Failed to get base path string");
         return false;
     }
 
+    // 流引用旧实例的锁与缓存, 重新初始化前全部关闭, 未提交的写入被丢弃
+    {
+        std::lock_guard<std::mutex> lock(g_stream_mutex);
+        g_read_streams.clear();
+        g_write_streams.clear();
+    }
+
     bool result = FileInterface::getInstance().initManager(path_chars,
                                                            static_cast<size_t>(cache_size),
-                                                           static_cast<bool>(use_async));
+                                                           static_cast<bool>(use_async),
+                                                           static_cast<size_t>(writer_threads > 0 ? writer_threads : 1),
+                                                           static_cast<size_t>(journal_bytes > 0 ? journal_bytes : 0),
+                                                           static_cast<bool>(watch_directories),
+                                                           static_cast<bool>(cross_process_locks));
     env->ReleaseStringUTFChars(base_path, path_chars);
     return result;
 }
@@ -67,13 +108,73 @@ static jstring readFile(JNIEnv *env, jobject instance, jstring business_id, jstr
     env->ReleaseStringUTFChars(business_id, biz_id);
     env->ReleaseStringUTFChars(filename, file_name);
 
-    if (!success || content.empty()) {
+    if (!success) {
         return nullptr;
     }
 
+    // 空文件返回空字符串, 与读取失败区分
     return env->NewStringUTF(content.c_str());
 }
 
+static jobject mapFile(JNIEnv *env, jobject instance, jstring business_id, jstring filename) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    if (!biz_id || !file_name) {
+        LOGE(TAG, "Failed to get string parameters");
+        if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+        if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+        return nullptr;
+    }
+
+    auto view = FileInterface::getInstance().map_file(biz_id, file_name);
+
+    env->ReleaseStringUTFChars(business_id, biz_id);
+    env->ReleaseStringUTFChars(filename, file_name);
+
+    if (!view) {
+        return nullptr;
+    }
+
+    if (view->empty()) {
+        // 空文件无需保留映射与锁
+        return env->NewDirectByteBuffer(&g_empty_mapping, 0);
+    }
+
+    void *address = const_cast<char *>(view->data());
+    jobject buffer = env->NewDirectByteBuffer(address, static_cast<jlong>(view->size()));
+    if (!buffer) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mapped_mutex);
+    g_mapped_views.emplace(address, std::move(view));
+    return buffer;
+}
+
+static void unmapFile(JNIEnv *env, jobject instance, jobject buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    void *address = env->GetDirectBufferAddress(buffer);
+    if (!address || address == &g_empty_mapping) {
+        return;
+    }
+
+    AtomicFileOperator::MappedView view;
+    {
+        std::lock_guard<std::mutex> lock(g_mapped_mutex);
+        auto it = g_mapped_views.find(address);
+        if (it == g_mapped_views.end()) {
+            return;
+        }
+        view = std::move(it->second);
+        g_mapped_views.erase(it);
+    }
+    // view 在锁外析构, munmap 与释放文件锁不阻塞其他映射请求
+}
+
 static jboolean
 updateFile(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jstring content) {
     const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
@@ -123,6 +224,541 @@ appendFile(JNIEnv *env, jobject instance, jstring business_id, jstring filename,
     return result;
 }
 
+// 二进制接口: 内容不经过 modified UTF-8 转换, 可包含任意字节 (含 \0)
+using WriteMethod = bool (FileInterface::*)(const std::string &, const std::string &, const std::string &);
+
+static jboolean
+writeBytes(JNIEnv *env, jstring business_id, jstring filename, const char *data, size_t size, WriteMethod method) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    jboolean result = false;
+
+    if (biz_id && file_name) {
+        result = (FileInterface::getInstance().*method)(
+                biz_id,
+                file_name,
+                std::string(data, size));
+    } else {
+        LOGE(TAG, "Failed to get string parameters");
+    }
+
+    if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+    if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+    return result;
+}
+
+// 临界区内只做一次拷贝, 加锁与文件 I/O 都在释放之后进行, 不会长时间阻塞 GC
+static bool copyByteArray(JNIEnv *env, jbyteArray array, std::string &output) {
+    jsize length = env->GetArrayLength(array);
+    output.assign(static_cast<size_t>(length), '\0');
+    if (length == 0) {
+        return true;
+    }
+    void *elements = env->GetPrimitiveArrayCritical(array, nullptr);
+    if (!elements) {
+        return false;
+    }
+    memcpy(output.data(), elements, output.size());
+    env->ReleasePrimitiveArrayCritical(array, elements, JNI_ABORT);
+    return true;
+}
+
+static jboolean
+writeByteArray(JNIEnv *env, jstring business_id, jstring filename, jbyteArray content, WriteMethod method) {
+    std::string payload;
+    if (!content || !copyByteArray(env, content, payload)) {
+        return false;
+    }
+
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    jboolean result = false;
+
+    if (biz_id && file_name) {
+        result = (FileInterface::getInstance().*method)(biz_id, file_name, payload);
+    } else {
+        LOGE(TAG, "Failed to get string parameters");
+    }
+
+    if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+    if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+    return result;
+}
+
+// 写入 direct ByteBuffer 中 [offset, offset + length) 的内容, 非 direct 或越界时返回 false
+static jboolean
+writeDirectBuffer(JNIEnv *env, jstring business_id, jstring filename, jobject buffer, jint offset, jint length,
+                  WriteMethod method) {
+    if (!buffer || offset < 0 || length < 0) {
+        return false;
+    }
+    auto *address = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || capacity < 0 || static_cast<jlong>(offset) + length > capacity) {
+        LOGE(TAG, "Invalid direct buffer");
+        return false;
+    }
+    return writeBytes(env, business_id, filename, address + offset, static_cast<size_t>(length), method);
+}
+
+static jboolean
+createFileBytes(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jbyteArray content) {
+    return writeByteArray(env, business_id, filename, content, &FileInterface::create_file);
+}
+
+static jboolean
+updateFileBytes(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jbyteArray content) {
+    return writeByteArray(env, business_id, filename, content, &FileInterface::update_file);
+}
+
+static jboolean
+appendFileBytes(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jbyteArray content) {
+    return writeByteArray(env, business_id, filename, content, &FileInterface::append_file);
+}
+
+static jboolean
+createFileBuffer(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jobject buffer,
+                 jint offset, jint length) {
+    return writeDirectBuffer(env, business_id, filename, buffer, offset, length, &FileInterface::create_file);
+}
+
+static jboolean
+updateFileBuffer(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jobject buffer,
+                 jint offset, jint length) {
+    return writeDirectBuffer(env, business_id, filename, buffer, offset, length, &FileInterface::update_file);
+}
+
+static jboolean
+appendFileBuffer(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jobject buffer,
+                 jint offset, jint length) {
+    return writeDirectBuffer(env, business_id, filename, buffer, offset, length, &FileInterface::append_file);
+}
+
+static bool readBytes(JNIEnv *env, jstring business_id, jstring filename, std::string &content) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    bool success = false;
+
+    if (biz_id && file_name) {
+        success = FileInterface::getInstance().read_file(biz_id, file_name, content);
+    } else {
+        LOGE(TAG, "Failed to get string parameters");
+    }
+
+    if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+    if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+    return success;
+}
+
+// 读取失败返回 null, 空文件返回长度为 0 的数组
+static jbyteArray readFileBytes(JNIEnv *env, jobject instance, jstring business_id, jstring filename) {
+    std::string content;
+    if (!readBytes(env, business_id, filename, content) ||
+        content.size() > static_cast<size_t>(std::numeric_limits<jsize>::max())) {
+        return nullptr;
+    }
+
+    auto length = static_cast<jsize>(content.size());
+    jbyteArray result = env->NewByteArray(length);
+    if (!result) {
+        return nullptr;
+    }
+    env->SetByteArrayRegion(result, 0, length, reinterpret_cast<const jbyte *>(content.data()));
+    return result;
+}
+
+// 读入 direct ByteBuffer 的 offset 处, 返回文件长度, 失败返回 -1
+// 剩余空间不足时不拷贝, 调用方可按返回的长度准备更大的 buffer 后重试
+static jint
+readFileBuffer(JNIEnv *env, jobject instance, jstring business_id, jstring filename, jobject buffer, jint offset) {
+    if (!buffer || offset < 0) {
+        return -1;
+    }
+    auto *address = static_cast<char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || capacity < offset) {
+        LOGE(TAG, "Invalid direct buffer");
+        return -1;
+    }
+
+    std::string content;
+    if (!readBytes(env, business_id, filename, content) ||
+        content.size() > static_cast<size_t>(std::numeric_limits<jint>::max())) {
+        return -1;
+    }
+    if (static_cast<jlong>(content.size()) <= capacity - offset) {
+        memcpy(address + offset, content.data(), content.size());
+    }
+    return static_cast<jint>(content.size());
+}
+
+// 批量接口: 一次 JNI 调用完成整批读写, 字符串数组中的元素逐个取出后立即释放局部引用
+static bool getArrayString(JNIEnv *env, jobjectArray array, jsize index, std::string &output) {
+    auto element = static_cast<jstring>(env->GetObjectArrayElement(array, index));
+    if (!element) {
+        return false;
+    }
+    const char *chars = env->GetStringUTFChars(element, nullptr);
+    if (chars) {
+        output = chars;
+        env->ReleaseStringUTFChars(element, chars);
+    }
+    env->DeleteLocalRef(element);
+    return chars != nullptr;
+}
+
+static jobjectArray batchRead(JNIEnv *env, jobject instance, jobjectArray business_ids, jobjectArray filenames) {
+    if (!business_ids || !filenames || env->GetArrayLength(business_ids) != env->GetArrayLength(filenames)) {
+        LOGE(TAG, "Invalid batch parameters");
+        return nullptr;
+    }
+
+    jsize count = env->GetArrayLength(business_ids);
+    std::vector<FileManager::BatchRead> reads(static_cast<size_t>(count));
+    std::vector<bool> valid(reads.size(), false);
+    for (jsize i = 0; i < count; ++i) {
+        valid[i] = getArrayString(env, business_ids, i, reads[i].business_id) &&
+                   getArrayString(env, filenames, i, reads[i].filename);
+    }
+
+    std::vector<std::string> outputs;
+    std::vector<bool> results = FileInterface::getInstance().batch_read(reads, outputs);
+
+    jclass byteArrayClass = env->FindClass("[B");
+    jobjectArray array = env->NewObjectArray(count, byteArrayClass, nullptr);
+    env->DeleteLocalRef(byteArrayClass);
+    if (!array) {
+        return nullptr;
+    }
+
+    // 读取失败的位置为 null, 空文件为长度为 0 的数组
+    for (jsize i = 0; i < count; ++i) {
+        const std::string &content = outputs[i];
+        if (!valid[i] || !results[i] || content.size() > static_cast<size_t>(std::numeric_limits<jsize>::max())) {
+            continue;
+        }
+        auto length = static_cast<jsize>(content.size());
+        jbyteArray bytes = env->NewByteArray(length);
+        if (!bytes) {
+            return nullptr;
+        }
+        env->SetByteArrayRegion(bytes, 0, length, reinterpret_cast<const jbyte *>(content.data()));
+        env->SetObjectArrayElement(array, i, bytes);
+        env->DeleteLocalRef(bytes);
+    }
+    return array;
+}
+
+// payload 为 null 表示删除该文件, 否则整体覆盖写入; 参数无效的写入不提交, indexes 记录提交的写入在数组中的下标
+static bool collectBatchWrites(JNIEnv *env, jobjectArray business_ids, jobjectArray filenames, jobjectArray payloads,
+                               std::vector<FileManager::BatchWrite> &writes, std::vector<jsize> &indexes) {
+    if (!business_ids || !filenames || !payloads ||
+        env->GetArrayLength(business_ids) != env->GetArrayLength(filenames) ||
+        env->GetArrayLength(business_ids) != env->GetArrayLength(payloads)) {
+        LOGE(TAG, "Invalid batch parameters");
+        return false;
+    }
+
+    jsize count = env->GetArrayLength(business_ids);
+    writes.reserve(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; ++i) {
+        FileManager::BatchWrite write{WriteType::UPDATE, "", "", ""};
+        bool valid = getArrayString(env, business_ids, i, write.business_id) &&
+                     getArrayString(env, filenames, i, write.filename);
+        auto payload = static_cast<jbyteArray>(env->GetObjectArrayElement(payloads, i));
+        if (!payload) {
+            write.type = WriteType::DELETE;
+        } else {
+            valid = copyByteArray(env, payload, write.payload) && valid;
+            env->DeleteLocalRef(payload);
+        }
+        if (valid) {
+            writes.push_back(std::move(write));
+            indexes.push_back(i);
+        }
+    }
+    return true;
+}
+
+// 未提交的写入结果为 false
+static jbooleanArray toBooleanArray(JNIEnv *env, jsize count, const std::vector<jsize> &indexes,
+                                    const std::vector<bool> &results) {
+    std::vector<jboolean> flags(static_cast<size_t>(count), JNI_FALSE);
+    for (size_t i = 0; i < indexes.size() && i < results.size(); ++i) {
+        flags[indexes[i]] = results[i] ? JNI_TRUE : JNI_FALSE;
+    }
+    jbooleanArray array = env->NewBooleanArray(count);
+    if (array) {
+        env->SetBooleanArrayRegion(array, 0, count, flags.data());
+    }
+    return array;
+}
+
+static jbooleanArray
+batchWrite(JNIEnv *env, jobject instance, jobjectArray business_ids, jobjectArray filenames, jobjectArray payloads) {
+    std::vector<FileManager::BatchWrite> writes;
+    std::vector<jsize> indexes;
+    if (!collectBatchWrites(env, business_ids, filenames, payloads, writes, indexes)) {
+        return nullptr;
+    }
+    std::vector<bool> results = FileInterface::getInstance().batch_write(std::move(writes));
+    return toBooleanArray(env, env->GetArrayLength(business_ids), indexes, results);
+}
+
+// 参数同 batchWrite, 返回完成句柄; 数组长度不一致时返回 0
+static jlong
+submitBatchWrite(JNIEnv *env, jobject instance, jobjectArray business_ids, jobjectArray filenames,
+                 jobjectArray payloads) {
+    PendingBatch batch;
+    std::vector<FileManager::BatchWrite> writes;
+    if (!collectBatchWrites(env, business_ids, filenames, payloads, writes, batch.indexes)) {
+        return 0;
+    }
+    batch.count = env->GetArrayLength(business_ids);
+    batch.results = FileInterface::getInstance().submit_batch(std::move(writes)).share();
+
+    std::lock_guard<std::mutex> lock(g_stream_mutex);
+    jlong handle = g_next_stream_handle++;
+    g_pending_batches.emplace(handle, std::move(batch));
+    return handle;
+}
+
+// 阻塞到整批执行完成, 按下标返回每个写入的结果并释放句柄; 未知句柄返回 null
+static jbooleanArray awaitBatchWrite(JNIEnv *env, jobject instance, jlong handle) {
+    PendingBatch batch;
+    {
+        std::lock_guard<std::mutex> lock(g_stream_mutex);
+        auto it = g_pending_batches.find(handle);
+        if (it == g_pending_batches.end()) {
+            return nullptr;
+        }
+        batch = std::move(it->second);
+        g_pending_batches.erase(it);
+    }
+
+    std::vector<bool> results;
+    try {
+        results = batch.results.get();
+    } catch (const std::exception &e) {
+        LOGE(TAG, "Pending batch abandoned: %s", e.what());
+    }
+    return toBooleanArray(env, batch.count, batch.indexes, results);
+}
+
+// 流式读写: 每次调用只搬运一块数据, 峰值内存与文件大小无关; 同一个流不支持多线程并发调用
+template<typename Stream>
+static jlong registerStream(std::unordered_map<jlong, std::shared_ptr<Stream>> &streams,
+                            std::unique_ptr<Stream> stream) {
+    if (!stream) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_stream_mutex);
+    jlong handle = g_next_stream_handle++;
+    streams.emplace(handle, std::move(stream));
+    return handle;
+}
+
+template<typename Stream>
+static std::shared_ptr<Stream> findStream(std::unordered_map<jlong, std::shared_ptr<Stream>> &streams,
+                                          jlong handle, bool remove) {
+    std::lock_guard<std::mutex> lock(g_stream_mutex);
+    auto it = streams.find(handle);
+    if (it == streams.end()) {
+        return nullptr;
+    }
+    auto stream = it->second;
+    if (remove) {
+        streams.erase(it);
+    }
+    return stream;
+}
+
+static jlong openReadStream(JNIEnv *env, jobject instance, jstring business_id, jstring filename) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    AtomicFileOperator::ReadStream stream;
+    if (biz_id && file_name) {
+        stream = FileInterface::getInstance().open_read_stream(biz_id, file_name);
+    } else {
+        LOGE(TAG, "Failed to get string parameters");
+    }
+
+    if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+    if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+    return registerStream(g_read_streams, std::move(stream));
+}
+
+static jlong readStreamSize(JNIEnv *env, jobject instance, jlong handle) {
+    auto stream = findStream(g_read_streams, handle, false);
+    return stream ? static_cast<jlong>(stream->size()) : -1;
+}
+
+// 读入 buffer 的 [offset, offset + length), 返回读取的字节数, 到达末尾返回 0, 出错返回 -1
+static jint readStream(JNIEnv *env, jobject instance, jlong handle, jbyteArray buffer, jint offset, jint length) {
+    auto stream = findStream(g_read_streams, handle, false);
+    if (!stream || !buffer || offset < 0 || length < 0 ||
+        static_cast<jlong>(offset) + length > env->GetArrayLength(buffer)) {
+        return -1;
+    }
+    // 不在临界区内做 I/O; 大数组不可移动, ART 直接返回数组地址, 无需额外拷贝
+    jbyte *elements = env->GetByteArrayElements(buffer, nullptr);
+    if (!elements) {
+        return -1;
+    }
+    ssize_t n = stream->read(reinterpret_cast<char *>(elements) + offset, static_cast<size_t>(length));
+    env->ReleaseByteArrayElements(buffer, elements, n > 0 ? 0 : JNI_ABORT);
+    return static_cast<jint>(n);
+}
+
+static jint
+readStreamBuffer(JNIEnv *env, jobject instance, jlong handle, jobject buffer, jint offset, jint length) {
+    auto stream = findStream(g_read_streams, handle, false);
+    if (!stream || !buffer || offset < 0 || length < 0) {
+        return -1;
+    }
+    auto *address = static_cast<char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || capacity < 0 || static_cast<jlong>(offset) + length > capacity) {
+        LOGE(TAG, "Invalid direct buffer");
+        return -1;
+    }
+    return static_cast<jint>(stream->read(address + offset, static_cast<size_t>(length)));
+}
+
+static void closeReadStream(JNIEnv *env, jobject instance, jlong handle) {
+    // 最后一个引用释放时关闭文件并释放读锁
+    findStream(g_read_streams, handle, true);
+}
+
+static jlong openWriteStream(JNIEnv *env, jobject instance, jstring business_id, jstring filename) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    AtomicFileOperator::WriteStream stream;
+    if (biz_id && file_name) {
+        stream = FileInterface::getInstance().open_write_stream(biz_id, file_name);
+    } else {
+        LOGE(TAG, "Failed to get string parameters");
+    }
+
+    if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+    if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+    return registerStream(g_write_streams, std::move(stream));
+}
+
+static jboolean
+writeStream(JNIEnv *env, jobject instance, jlong handle, jbyteArray buffer, jint offset, jint length) {
+    auto stream = findStream(g_write_streams, handle, false);
+    if (!stream || !buffer || offset < 0 || length < 0 ||
+        static_cast<jlong>(offset) + length > env->GetArrayLength(buffer)) {
+        return false;
+    }
+    jbyte *elements = env->GetByteArrayElements(buffer, nullptr);
+    if (!elements) {
+        return false;
+    }
+    bool result = stream->write(reinterpret_cast<const char *>(elements) + offset, static_cast<size_t>(length));
+    env->ReleaseByteArrayElements(buffer, elements, JNI_ABORT);
+    return result;
+}
+
+static jboolean
+writeStreamBuffer(JNIEnv *env, jobject instance, jlong handle, jobject buffer, jint offset, jint length) {
+    auto stream = findStream(g_write_streams, handle, false);
+    if (!stream || !buffer || offset < 0 || length < 0) {
+        return false;
+    }
+    auto *address = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || capacity < 0 || static_cast<jlong>(offset) + length > capacity) {
+        LOGE(TAG, "Invalid direct buffer");
+        return false;
+    }
+    return stream->write(address + offset, static_cast<size_t>(length));
+}
+
+// 提交并关闭, 无论成功与否句柄都随之失效
+static jboolean commitWriteStream(JNIEnv *env, jobject instance, jlong handle) {
+    auto stream = findStream(g_write_streams, handle, true);
+    return stream && stream->commit();
+}
+
+static void abortWriteStream(JNIEnv *env, jobject instance, jlong handle) {
+    findStream(g_write_streams, handle, true);
+}
+
+// type 取 FileSystem.WRITE_* 常量, 删除时 content 可以为 null; 参数无效时返回 0
+static jlong submitWrite(JNIEnv *env, jobject instance, jint type, jstring business_id, jstring filename,
+                         jbyteArray content) {
+    if (type < static_cast<jint>(WriteType::CREATE) || type > static_cast<jint>(WriteType::DELETE)) {
+        LOGE(TAG, "Invalid write type %d", type);
+        return 0;
+    }
+    const auto write_type = static_cast<WriteType>(type);
+    std::string payload;
+    if (write_type != WriteType::DELETE && (!content || !copyByteArray(env, content, payload))) {
+        return 0;
+    }
+
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *file_name = env->GetStringUTFChars(filename, nullptr);
+
+    std::future<bool> result;
+    if (biz_id && file_name) {
+        result = FileInterface::getInstance().submit_write(write_type, biz_id, file_name, payload);
+    } else {
+        LOGE(TAG, "Failed to get string parameters");
+    }
+
+    if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+    if (file_name) env->ReleaseStringUTFChars(filename, file_name);
+    if (!result.valid()) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(g_stream_mutex);
+    jlong handle = g_next_stream_handle++;
+    g_pending_writes.emplace(handle, result.share());
+    return handle;
+}
+
+static std::shared_future<bool> findPendingWrite(jlong handle, bool remove) {
+    std::lock_guard<std::mutex> lock(g_stream_mutex);
+    auto it = g_pending_writes.find(handle);
+    if (it == g_pending_writes.end()) {
+        return {};
+    }
+    auto result = it->second;
+    if (remove) {
+        g_pending_writes.erase(it);
+    }
+    return result;
+}
+
+static jboolean isWriteDone(JNIEnv *env, jobject instance, jlong handle) {
+    auto result = findPendingWrite(handle, false);
+    return result.valid() && result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+// 阻塞到写入执行完成, 返回执行结果并释放句柄; 未知句柄返回 false
+static jboolean awaitWrite(JNIEnv *env, jobject instance, jlong handle) {
+    auto result = findPendingWrite(handle, true);
+    if (!result.valid()) {
+        return false;
+    }
+    try {
+        return result.get();
+    } catch (const std::exception &e) {
+        // 写入器析构时未执行的请求
+        LOGE(TAG, "Pending write abandoned: %s", e.what());
+        return false;
+    }
+}
+
 static jboolean deleteFile(JNIEnv *env, jobject instance, jstring business_id, jstring filename) {
     const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
     const char *file_name = env->GetStringUTFChars(filename, nullptr);
@@ -163,6 +799,22 @@ static jboolean fileExists(JNIEnv *env, jobject instance, jstring business_id, j
     return result;
 }
 
+static jobject toJavaList(JNIEnv *env, const std::vector<std::string> &files) {
+    jclass arrayListClass = env->FindClass("java/util/ArrayList");
+    jmethodID arrayListConstructor = env->GetMethodID(arrayListClass, "<init>", "(I)V");
+    jmethodID addMethod = env->GetMethodID(arrayListClass, "add", "(Ljava/lang/Object;)Z");
+
+    jobject result = env->NewObject(arrayListClass, arrayListConstructor, static_cast<jint>(files.size()));
+
+    for (const std::string &file: files) {
+        jstring javaString = env->NewStringUTF(file.c_str());
+        env->CallBooleanMethod(result, addMethod, javaString);
+        env->DeleteLocalRef(javaString);
+    }
+    env->DeleteLocalRef(arrayListClass);
+    return result;
+}
+
 static jobject prefetchDirectory(JNIEnv *env, jobject instance, jstring business_id, jstring substr, jint day, jboolean flag) {
     const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
     const char *sub_str = env->GetStringUTFChars(substr, nullptr);
@@ -185,32 +837,129 @@ static jobject prefetchDirectory(JNIEnv *env, jobject instance, jstring business
     env->ReleaseStringUTFChars(business_id, biz_id);
     env->ReleaseStringUTFChars(substr, sub_str);
 
-    jclass arrayListClass = env->FindClass("java/util/ArrayList");
-    jmethodID arrayListConstructor = env->GetMethodID(arrayListClass, "<init>", "(I)V");
-    jmethodID addMethod = env->GetMethodID(arrayListClass, "add", "(Ljava/lang/Object;)Z");
-
-    jobject result = env->NewObject(arrayListClass, arrayListConstructor, files.size());
+    return toJavaList(env, files);
+}
 
-    jclass stringClass = env->FindClass("java/lang/String");
+// 每页构造一个 List 回调 Java, 回调与扫描在同一线程上执行
+static jboolean prefetchDirectoryPaged(JNIEnv *env, jobject instance, jstring business_id, jstring substr,
+                                       jint day, jboolean flag, jint page_size, jobject callback) {
+    if (!callback) {
+        return false;
+    }
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    const char *sub_str = env->GetStringUTFChars(substr, nullptr);
+    if (!biz_id || !sub_str) {
+        LOGE(TAG, "Failed to get string parameters");
+        if (biz_id) env->ReleaseStringUTFChars(business_id, biz_id);
+        if (sub_str) env->ReleaseStringUTFChars(substr, sub_str);
+        return false;
+    }
 
-    for (const std::string &file: files) {
-        jstring javaString = env->NewStringUTF(file.c_str());
-        env->CallBooleanMethod(result, addMethod, javaString);
-        env->DeleteLocalRef(javaString);
+    jclass callbackClass = env->GetObjectClass(callback);
+    jmethodID onPage = env->GetMethodID(callbackClass, "onPage", "(Ljava/util/List;)Z");
+    env->DeleteLocalRef(callbackClass);
+    if (!onPage) {
+        env->ReleaseStringUTFChars(business_id, biz_id);
+        env->ReleaseStringUTFChars(substr, sub_str);
+        return false;
     }
+
+    bool result = FileInterface::getInstance().prefetch_directory(
+            biz_id,
+            sub_str,
+            static_cast<int32_t>(day),
+            flag == JNI_TRUE,
+            static_cast<size_t>(page_size > 0 ? page_size : FileManager::DEFAULT_PAGE_SIZE),
+            [env, callback, onPage](std::vector<std::string> &page) {
+                jobject list = toJavaList(env, page);
+                jboolean more = env->CallBooleanMethod(callback, onPage, list);
+                env->DeleteLocalRef(list);
+                // 回调抛出异常时停止, 异常在返回 Java 后继续传播
+                return !env->ExceptionCheck() && more == JNI_TRUE;
+            });
+
+    env->ReleaseStringUTFChars(business_id, biz_id);
+    env->ReleaseStringUTFChars(substr, sub_str);
     return result;
 }
 
+static void setCompression(JNIEnv *env, jobject instance, jstring business_id, jboolean enabled) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    if (!biz_id) {
+        LOGE(TAG, "Failed to get business_id string");
+        return;
+    }
+    FileInterface::getInstance().set_compression(biz_id, enabled == JNI_TRUE);
+    env->ReleaseStringUTFChars(business_id, biz_id);
+}
+
+static jboolean enablePackedStorage(JNIEnv *env, jobject instance, jstring business_id) {
+    const char *biz_id = env->GetStringUTFChars(business_id, nullptr);
+    if (!biz_id) {
+        LOGE(TAG, "Failed to get business_id string");
+        return JNI_FALSE;
+    }
+    bool result = FileInterface::getInstance().enable_packed_storage(biz_id);
+    env->ReleaseStringUTFChars(business_id, biz_id);
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
+static jint setIoBackend(JNIEnv *env, jobject instance, jint backend) {
+    return static_cast<jint>(FileInterface::getInstance().set_io_backend(static_cast<int>(backend)));
+}
+
+static void flushWrites(JNIEnv *env, jobject instance) {
+    FileInterface::getInstance().flush_writes();
+}
+
+
+static void onTrimMemory(JNIEnv *env, jobject instance, jint level) {
+    FileInterface::getInstance().on_trim_memory(static_cast<int>(level));
+}
+
 
 static const JNINativeMethod gMethod[] = {
-        {"initManager",       "(Ljava/lang/String;IZ)Z",                                   (void *) initManager},
+        {"initManager",       "(Ljava/lang/String;IZIIZZ)Z",                               (void *) initManager},
         {"createFile",        "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Z", (void *) createFile},
         {"readFile",          "(Ljava/lang/String;Ljava/lang/String;)Ljava/lang/String;",  (void *) readFile},
+        {"mapFile",           "(Ljava/lang/String;Ljava/lang/String;)Ljava/nio/ByteBuffer;", (void *) mapFile},
+        {"unmapFile",         "(Ljava/nio/ByteBuffer;)V",                                  (void *) unmapFile},
         {"updateFile",        "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Z", (void *) updateFile},
         {"appendFile",        "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Z", (void *) appendFile},
+        {"createFileBytes",   "(Ljava/lang/String;Ljava/lang/String;[B)Z",                 (void *) createFileBytes},
+        {"readFileBytes",     "(Ljava/lang/String;Ljava/lang/String;)[B",                  (void *) readFileBytes},
+        {"updateFileBytes",   "(Ljava/lang/String;Ljava/lang/String;[B)Z",                 (void *) updateFileBytes},
+        {"appendFileBytes",   "(Ljava/lang/String;Ljava/lang/String;[B)Z",                 (void *) appendFileBytes},
+        {"createFileBuffer",  "(Ljava/lang/String;Ljava/lang/String;Ljava/nio/ByteBuffer;II)Z", (void *) createFileBuffer},
+        {"readFileBuffer",    "(Ljava/lang/String;Ljava/lang/String;Ljava/nio/ByteBuffer;I)I", (void *) readFileBuffer},
+        {"updateFileBuffer",  "(Ljava/lang/String;Ljava/lang/String;Ljava/nio/ByteBuffer;II)Z", (void *) updateFileBuffer},
+        {"appendFileBuffer",  "(Ljava/lang/String;Ljava/lang/String;Ljava/nio/ByteBuffer;II)Z", (void *) appendFileBuffer},
+        {"batchRead",         "([Ljava/lang/String;[Ljava/lang/String;)[[B",              (void *) batchRead},
+        {"batchWrite",        "([Ljava/lang/String;[Ljava/lang/String;[[B)[Z",             (void *) batchWrite},
+        {"submitBatchWrite",  "([Ljava/lang/String;[Ljava/lang/String;[[B)J",              (void *) submitBatchWrite},
+        {"awaitBatchWrite",   "(J)[Z",                                                     (void *) awaitBatchWrite},
+        {"openReadStream",    "(Ljava/lang/String;Ljava/lang/String;)J",                   (void *) openReadStream},
+        {"readStreamSize",    "(J)J",                                                      (void *) readStreamSize},
+        {"readStream",        "(J[BII)I",                                                  (void *) readStream},
+        {"readStreamBuffer",  "(JLjava/nio/ByteBuffer;II)I",                               (void *) readStreamBuffer},
+        {"closeReadStream",   "(J)V",                                                      (void *) closeReadStream},
+        {"openWriteStream",   "(Ljava/lang/String;Ljava/lang/String;)J",                   (void *) openWriteStream},
+        {"writeStream",       "(J[BII)Z",                                                  (void *) writeStream},
+        {"writeStreamBuffer", "(JLjava/nio/ByteBuffer;II)Z",                               (void *) writeStreamBuffer},
+        {"commitWriteStream", "(J)Z",                                                      (void *) commitWriteStream},
+        {"abortWriteStream",  "(J)V",                                                      (void *) abortWriteStream},
+        {"submitWrite",       "(ILjava/lang/String;Ljava/lang/String;[B)J",                (void *) submitWrite},
+        {"isWriteDone",       "(J)Z",                                                      (void *) isWriteDone},
+        {"awaitWrite",        "(J)Z",                                                      (void *) awaitWrite},
         {"deleteFile",        "(Ljava/lang/String;Ljava/lang/String;)Z",                   (void *) deleteFile},
         {"fileExists",        "(Ljava/lang/String;Ljava/lang/String;)Z",                   (void *) fileExists},
         {"prefetchDirectory", "(Ljava/lang/String;Ljava/lang/String;IZ)Ljava/util/List;",  (void *) prefetchDirectory},
+        {"prefetchDirectoryPaged", "(Ljava/lang/String;Ljava/lang/String;IZILcom/example/file_module/DirectoryPageCallback;)Z", (void *) prefetchDirectoryPaged},
+        {"setCompression",    "(Ljava/lang/String;Z)V",                                    (void *) setCompression},
+        {"enablePackedStorage", "(Ljava/lang/String;)Z",                                   (void *) enablePackedStorage},
+        {"setIoBackend",      "(I)I",                                                      (void *) setIoBackend},
+        {"flushWrites",       "()V",                                                       (void *) flushWrites},
+        {"onTrimMemory",      "(I)V",                                                      (void *) onTrimMemory},
 };
 
 
@@ -0,0 +1,9 @@
+package com.example.file_module
+
+/**
+ * 分页接收目录列举结果, 在调用 prefetchDirectoryPaged 的线程上回调
+ * 返回 false 停止接收剩余结果
+ */
+fun interface DirectoryPageCallback {
+    fun onPage(files: List<String>): Boolean
+}
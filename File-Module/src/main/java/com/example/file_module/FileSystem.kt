@@ -1,7 +1,10 @@
 package com.example.file_module
 
+import android.content.ComponentCallbacks2
 import android.content.Context
+import android.content.res.Configuration
 import android.util.Log
+import java.nio.ByteBuffer
 
 
 class FileSystem {
@@ -11,19 +14,147 @@ class FileSystem {
         init {
             System.loadLibrary("file_module")
         }
+
+        // setIoBackend 的取值
+        const val IO_BACKEND_SYNC = 0
+        const val IO_BACKEND_IO_URING = 1
+
+        // submitWrite 的写入类型
+        const val WRITE_CREATE = 0
+        const val WRITE_UPDATE = 1
+        const val WRITE_APPEND = 2
+        const val WRITE_DELETE = 3
     }
 
     private val businessId = "user_profiles"
 
 
-    // 初始化文件管理器
-    external fun initManager(basePath: String?, cacheSize: Int, useAsync: Boolean): Boolean
+    /**
+     * 初始化文件管理器
+     * @param writerThreads 异步写入线程数, 同一文件的写入始终在同一线程上按顺序执行
+     * @param journalBytes 异步写入预写日志的容量, 大于 0 时进程被杀后未执行的写入会在下次初始化时重放; 传 0 关闭
+     * @param watchDirectories 通过 inotify 监听业务目录, 其他进程的修改会及时失效缓存, 缓存校验不再需要 stat
+     * @param crossProcessLocks 文件锁同时对其他进程生效, 多个进程读写同一 basePath 时开启;
+     * 开启后不使用内容缓存, 每次读取重新 stat, 自动监听业务目录, 不能与 enablePackedStorage 同时使用
+     */
+    external fun initManager(basePath: String?, cacheSize: Int, useAsync: Boolean,
+                             writerThreads: Int = 1, journalBytes: Int = 0,
+                             watchDirectories: Boolean = false,
+                             crossProcessLocks: Boolean = false): Boolean
+
+    /**
+     * 按业务开启压缩存储, 适合 JSON 与文本日志; 压缩在写入线程上执行, 读取时自动解压
+     * 关闭后已压缩的文件仍可正常读取; mapFile 与流式读写访问的是磁盘上的原始字节, 压缩目录中应使用 readFile 系列接口
+     */
+    external fun setCompression(businessId: String?, enabled: Boolean)
+
+    /**
+     * 按业务开启小文件打包存储, 适合大量 4KB 以内的小文件; 小文件追加到同一个段文件中, 不再各占一个 inode
+     * 开启后不可关闭, 重启后自动识别; 已有文件照常读写; 包内文件不支持 mapFile 与流式读取; 开启了跨进程锁时返回 false
+     */
+    external fun enablePackedStorage(businessId: String?): Boolean
+
+    /**
+     * 切换批量写入的 I/O 后端, 返回实际生效的后端; 设备不支持 io_uring (内核低于 5.15 或被系统策略禁止) 时回退到 IO_BACKEND_SYNC
+     * io_uring 后端下异步写入的每个批次在一次提交中完成打开, 写入, 落盘与重命名
+     */
+    external fun setIoBackend(backend: Int): Int
+
+    // 阻塞直到此前提交的异步写入全部完成
+    external fun flushWrites()
+
+    // 转发 ComponentCallbacks2.onTrimMemory, 按内存压力裁剪缓存并缩短后台维护间隔
+    external fun onTrimMemory(level: Int)
 
-    // 文件操作
+    // 文件操作; 以 ".fm-" 开头的文件名保留给内部临时文件, 写入返回 false
+    // 异步模式下写入接口不等待执行, 返回 true 只表示已入队; 需要执行结果时使用 submitWrite
     external fun createFile(businessId: String?, filename: String?, content: String?): Boolean
     external fun readFile(businessId: String?, filename: String?): String?
     external fun updateFile(businessId: String?, filename: String?, content: String?): Boolean
+
+    /**
+     * 零拷贝读取: 返回文件映射的只读 direct ByteBuffer, 不可写入
+     * 映射期间持有文件读锁, 使用完毕必须调用 unmapFile 释放, 否则对该文件的写操作会一直阻塞
+     */
+    external fun mapFile(businessId: String?, filename: String?): ByteBuffer?
+    external fun unmapFile(buffer: ByteBuffer?)
     external fun appendFile(businessId: String?, filename: String?, content: String?): Boolean
+
+    /**
+     * 二进制读写: 内容按原始字节传递, 不经过 modified UTF-8 转换, 可写入任意二进制数据
+     * readFileBytes 读取失败返回 null, 空文件返回空数组
+     */
+    external fun createFileBytes(businessId: String?, filename: String?, content: ByteArray?): Boolean
+    external fun readFileBytes(businessId: String?, filename: String?): ByteArray?
+    external fun updateFileBytes(businessId: String?, filename: String?, content: ByteArray?): Boolean
+    external fun appendFileBytes(businessId: String?, filename: String?, content: ByteArray?): Boolean
+
+    /**
+     * direct ByteBuffer 读写, 直接使用 buffer 的 native 地址, 非 direct buffer 返回失败
+     * 写入 [offset, offset + length) 的内容, 默认为 position 到 limit, 不改变 buffer 的 position
+     */
+    external fun createFileBuffer(businessId: String?, filename: String?, buffer: ByteBuffer?,
+                                  offset: Int = buffer?.position() ?: 0,
+                                  length: Int = buffer?.remaining() ?: 0): Boolean
+    external fun updateFileBuffer(businessId: String?, filename: String?, buffer: ByteBuffer?,
+                                  offset: Int = buffer?.position() ?: 0,
+                                  length: Int = buffer?.remaining() ?: 0): Boolean
+    external fun appendFileBuffer(businessId: String?, filename: String?, buffer: ByteBuffer?,
+                                  offset: Int = buffer?.position() ?: 0,
+                                  length: Int = buffer?.remaining() ?: 0): Boolean
+
+    /**
+     * 读入 buffer 的 offset 处, 返回文件长度, 读取失败返回 -1
+     * 返回值大于 capacity - offset 时内容未拷贝, 需按返回的长度准备更大的 buffer 后重试
+     */
+    external fun readFileBuffer(businessId: String?, filename: String?, buffer: ByteBuffer?, offset: Int = 0): Int
+
+    /**
+     * 批量读写: 一次 JNI 调用完成整批操作, 三个数组按下标一一对应, 长度不一致时返回 null
+     * batchRead 读取失败的位置为 null; batchWrite 中 payload 为 null 表示删除该文件, 否则整体覆盖写入
+     * 同一目录的文件相邻处理; 异步模式下整批一次入队, 按文件分派到各写入线程, 整批不是原子的, 可能部分成功
+     * 异步模式下 batchWrite 返回 true 只表示已入队; 需要每个写入的执行结果时使用 submitBatchWrite,
+     * 之后 awaitBatchWrite 阻塞到整批完成并按下标返回结果, 句柄随之失效
+     */
+    external fun batchRead(businessIds: Array<String?>, filenames: Array<String?>): Array<ByteArray?>?
+    external fun batchWrite(businessIds: Array<String?>, filenames: Array<String?>,
+                            payloads: Array<ByteArray?>): BooleanArray?
+    external fun submitBatchWrite(businessIds: Array<String?>, filenames: Array<String?>,
+                                  payloads: Array<ByteArray?>): Long
+    external fun awaitBatchWrite(handle: Long): BooleanArray?
+
+    /**
+     * 流式读取大文件: openReadStream 返回游标句柄, 失败返回 0; 之后分块读取, 峰值内存只有一块
+     * readStream/readStreamBuffer 返回本次读取的字节数, 到达末尾返回 0, 出错返回 -1
+     * 游标存活期间持有文件读锁, 读完必须调用 closeReadStream, 否则对该文件的写操作会一直阻塞
+     */
+    external fun openReadStream(businessId: String?, filename: String?): Long
+    external fun readStreamSize(handle: Long): Long
+    external fun readStream(handle: Long, buffer: ByteArray?, offset: Int = 0, length: Int = buffer?.size ?: 0): Int
+    external fun readStreamBuffer(handle: Long, buffer: ByteBuffer?, offset: Int = buffer?.position() ?: 0,
+                                  length: Int = buffer?.remaining() ?: 0): Int
+    external fun closeReadStream(handle: Long)
+
+    /**
+     * 流式写入大文件: 内容先写入临时文件, commitWriteStream 时原子替换目标文件, 之前读到的始终是旧内容
+     * commitWriteStream 与 abortWriteStream 都会关闭句柄, 放弃写入时调用 abortWriteStream 删除临时文件
+     */
+    external fun openWriteStream(businessId: String?, filename: String?): Long
+    external fun writeStream(handle: Long, buffer: ByteArray?, offset: Int = 0, length: Int = buffer?.size ?: 0): Boolean
+    external fun writeStreamBuffer(handle: Long, buffer: ByteBuffer?, offset: Int = buffer?.position() ?: 0,
+                                   length: Int = buffer?.remaining() ?: 0): Boolean
+    external fun commitWriteStream(handle: Long): Boolean
+    external fun abortWriteStream(handle: Long)
+
+    /**
+     * 提交写入并返回完成句柄, 参数无效时返回 0; 异步模式下写入线程执行完成后才能拿到结果
+     * type 取 WRITE_* 常量, WRITE_DELETE 时 content 可以为 null
+     * isWriteDone 不阻塞地查询是否已完成; awaitWrite 阻塞到完成并返回执行结果, 之后句柄失效, 每个句柄必须 await 一次
+     */
+    external fun submitWrite(type: Int, businessId: String?, filename: String?, content: ByteArray?): Long
+    external fun isWriteDone(handle: Long): Boolean
+    external fun awaitWrite(handle: Long): Boolean
+
     external fun deleteFile(businessId: String?, filename: String?): Boolean
     external fun fileExists(businessId: String?, filename: String?): Boolean
 
@@ -36,10 +167,23 @@ class FileSystem {
      */
     external fun prefetchDirectory(businessId: String?, substr: String = "", day: Int = 0, flag: Boolean = true) : List<String>?
 
+    /**
+     * 分页列举, 参数含义同 prefetchDirectory
+     * 大目录首次列举时边扫描边回调, 不必等待扫描结束即可拿到第一页; 返回 false 表示目录无法读取
+     * @param pageSize 每页文件数, 传 0 使用默认值
+     */
+    external fun prefetchDirectoryPaged(businessId: String?, substr: String = "", day: Int = 0, flag: Boolean = true,
+                                        pageSize: Int = 0, callback: DirectoryPageCallback): Boolean
+
     // 应用中使用示例
     fun init(context: Context) {
         val dir = context.filesDir
         initManager(dir.absolutePath, 1500, true)
+        context.applicationContext.registerComponentCallbacks(object : ComponentCallbacks2 {
+            override fun onTrimMemory(level: Int) = this@FileSystem.onTrimMemory(level)
+            override fun onConfigurationChanged(newConfig: Configuration) {}
+            override fun onLowMemory() = this@FileSystem.onTrimMemory(ComponentCallbacks2.TRIM_MEMORY_COMPLETE)
+        })
     }
 
     fun saveUserProfile(userId: String?, json: String?): Boolean {